@@ -0,0 +1,40 @@
+#!/bin/sh
+# -*- coding: utf-8 -*-
+# Copyright (C) 2019 Laboratoire de Recherche et Développement de
+# l'Epita (LRDE).
+#
+# This file is part of TCLTL, a model checker for timed automata.
+#
+# TCLTL is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# TCLTL is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+# License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: counters.sh N [M]
+#
+# Output a TChecker model of N processes, each incrementing its own
+# counter from 0 to M.  It has no clock, so its zone graph is its
+# graph of (M+1)^N valuations, with N*M*(M+1)^(N-1) edges, whatever
+# the zone semantics.  tests/perf.baseline relies on these numbers.
+
+N=${1?missing number of processes}
+M=${2-2}
+
+echo "system:counters_${N}_${M}"
+echo "event:tau"
+
+for i in `seq 1 $N`; do
+  P=P$i
+  echo "int:1:0:$M:0:c$i"
+  echo "process:$P"
+  echo "location:$P:l{initial:}"
+  echo "edge:$P:l:l:tau{provided: c$i<$M : do: c$i=c$i+1}"
+done
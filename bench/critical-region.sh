@@ -0,0 +1,78 @@
+#!/bin/sh
+# -*- coding: utf-8 -*-
+# Copyright (C) 2019 Laboratoire de Recherche et Développement de
+# l'Epita (LRDE).
+#
+# This file is part of TCLTL, a model checker for timed automata.
+#
+# TCLTL is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# TCLTL is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+# License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: critical-region.sh N [K]
+#
+# Output a TChecker model of N production cells competing for a
+# critical region guarded by N arbiters and a counter.  This is the
+# family generated by "examples/critical-region.sh" in TChecker, and
+# used in tests/basic.test for N=1, K=10.
+
+N=${1?missing number of processes}
+K=${2-10}
+
+echo "system:critical_region_${N}_${K}"
+echo "event:tau"
+for i in `seq 1 $N`; do
+  echo "event:enter$i"
+  echo "event:exit$i"
+done
+echo "int:1:0:$N:0:id"
+
+echo "process:counter"
+echo "location:counter:I{initial:}"
+echo "location:counter:C{}"
+echo "edge:counter:I:C:tau{provided: id==0 : do: id=1}"
+echo "edge:counter:C:C:tau{provided: id<$N : do: id=id+1}"
+echo "edge:counter:C:C:tau{provided: id==$N : do: id=1}"
+
+for i in `seq 1 $N`; do
+  echo "process:arbiter$i"
+  echo "location:arbiter$i:req{initial:}"
+  echo "location:arbiter$i:ack{}"
+  echo "edge:arbiter$i:req:ack:enter$i{provided: id==$i : do: id=0}"
+  echo "edge:arbiter$i:ack:req:exit$i{do: id=$i}"
+done
+
+for i in `seq 1 $N`; do
+  P=prodcell$i
+  echo "process:$P"
+  echo "clock:1:x$i"
+  echo "location:$P:not_ready{initial:}"
+  echo "location:$P:testing{invariant: x$i<=$K}"
+  echo "location:$P:requesting{}"
+  echo "location:$P:critical{invariant: x$i<=$((2*K))}"
+  echo "location:$P:testing2{invariant: x$i<=$K}"
+  echo "location:$P:safe{}"
+  echo "location:$P:error{}"
+  echo "edge:$P:not_ready:testing:tau{provided: x$i<=$((2*K)) : do: x$i=0}"
+  echo "edge:$P:testing:not_ready:tau{provided: x$i>=$K : do: x$i=0}"
+  echo "edge:$P:testing:requesting:tau{provided: x$i<=$((K-1))}"
+  echo "edge:$P:requesting:critical:enter$i{do: x$i=0}"
+  echo "edge:$P:critical:error:tau{provided: x$i>=$((2*K))}"
+  echo "edge:$P:critical:testing2:exit$i{provided: x$i<=$((K-1)) : do: x$i=0}"
+  echo "edge:$P:testing2:error:tau{provided: x$i>=$K}"
+  echo "edge:$P:testing2:safe:tau{provided: x$i<=$((K-1))}"
+done
+
+for i in `seq 1 $N`; do
+  echo "sync:arbiter$i@enter$i:prodcell$i@enter$i"
+  echo "sync:arbiter$i@exit$i:prodcell$i@exit$i"
+done
@@ -0,0 +1,82 @@
+#!/bin/sh
+# -*- coding: utf-8 -*-
+# Copyright (C) 2019 Laboratoire de Recherche et Développement de
+# l'Epita (LRDE).
+#
+# This file is part of TCLTL, a model checker for timed automata.
+#
+# TCLTL is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# TCLTL is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+# License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: csmacd.sh N [LAMBDA] [SIGMA]
+#
+# Output a TChecker model of the CSMA/CD protocol: N stations sharing
+# a bus.  LAMBDA is the time needed to send a message, SIGMA the
+# propagation delay of the bus.
+
+N=${1?missing number of stations}
+LAMBDA=${2-808}
+SIGMA=${3-26}
+
+echo "system:csmacd_${N}"
+echo "event:tau"
+echo "event:begin"
+echo "event:end"
+echo "event:busy"
+echo "event:cd"
+for i in `seq 1 $N`; do
+  echo "event:begin$i"
+  echo "event:end$i"
+  echo "event:busy$i"
+done
+
+echo "process:Bus"
+echo "clock:1:y"
+echo "location:Bus:idle{initial:}"
+echo "location:Bus:active{}"
+echo "location:Bus:collision{invariant: y<$SIGMA}"
+for i in `seq 1 $N`; do
+  echo "edge:Bus:idle:active:begin$i{do: y=0}"
+  echo "edge:Bus:active:idle:end$i{do: y=0}"
+  echo "edge:Bus:active:active:busy$i{provided: y>=$SIGMA}"
+  echo "edge:Bus:active:collision:begin$i{provided: y<$SIGMA : do: y=0}"
+done
+echo "edge:Bus:collision:idle:cd{provided: y<$SIGMA : do: y=0}"
+
+for i in `seq 1 $N`; do
+  S=S$i
+  echo "process:$S"
+  echo "clock:1:x$i"
+  echo "location:$S:wait{initial:}"
+  echo "location:$S:transm{invariant: x$i<=$LAMBDA}"
+  echo "location:$S:retry{invariant: x$i<$((2*SIGMA))}"
+  echo "edge:$S:wait:transm:begin{do: x$i=0}"
+  echo "edge:$S:wait:retry:busy{do: x$i=0}"
+  echo "edge:$S:wait:retry:cd{do: x$i=0}"
+  echo "edge:$S:transm:wait:end{provided: x$i==$LAMBDA : do: x$i=0}"
+  echo "edge:$S:transm:retry:cd{provided: x$i<$((2*SIGMA)) : do: x$i=0}"
+  echo "edge:$S:retry:transm:begin{provided: x$i<$((2*SIGMA)) : do: x$i=0}"
+  echo "edge:$S:retry:retry:busy{provided: x$i<$((2*SIGMA)) : do: x$i=0}"
+  echo "edge:$S:retry:retry:cd{provided: x$i<$((2*SIGMA)) : do: x$i=0}"
+done
+
+cd="sync:Bus@cd"
+for i in `seq 1 $N`; do
+  echo "sync:Bus@begin$i:S$i@begin"
+  echo "sync:Bus@end$i:S$i@end"
+  echo "sync:Bus@busy$i:S$i@busy"
+  # Collision detection is broadcast to the stations that can
+  # receive it.
+  cd="$cd:S$i@cd?"
+done
+echo "$cd"
@@ -0,0 +1,73 @@
+#!/bin/sh
+# -*- coding: utf-8 -*-
+# Copyright (C) 2019 Laboratoire de Recherche et Développement de
+# l'Epita (LRDE).
+#
+# This file is part of TCLTL, a model checker for timed automata.
+#
+# TCLTL is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# TCLTL is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+# License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: fddi.sh N [SA]
+#
+# Output a TChecker model of an FDDI-like token ring with N stations.
+# A station holding the token first performs a synchronous
+# transmission of duration SA, then may transmit asynchronously as
+# long as its token-rotation timer has not reached TTRT=50*N.
+
+N=${1?missing number of stations}
+SA=${2-20}
+TTRT=$((50*N))
+
+echo "system:fddi_${N}"
+echo "event:tau"
+echo "event:tt"
+echo "event:rt"
+for i in `seq 1 $N`; do
+  echo "event:tt$i"
+  echo "event:rt$i"
+done
+
+echo "process:Ring"
+echo "clock:1:z"
+for i in `seq 1 $N`; do
+  if test $i -eq 1; then init='initial: : '; else init=; fi
+  echo "location:Ring:to$i{${init}invariant: z<=0}"
+  echo "location:Ring:at$i{}"
+done
+for i in `seq 1 $N`; do
+  next=$((i % N + 1))
+  echo "edge:Ring:to$i:at$i:tt$i{}"
+  echo "edge:Ring:at$i:to$next:rt$i{do: z=0}"
+done
+
+for i in `seq 1 $N`; do
+  S=ST$i
+  echo "process:$S"
+  echo "clock:1:trt$i"
+  echo "clock:1:y$i"
+  echo "location:$S:idle{initial:}"
+  echo "location:$S:st{invariant: y$i<=$SA}"
+  echo "location:$S:decide{invariant: y$i<=$SA}"
+  echo "location:$S:async{invariant: trt$i<=$TTRT}"
+  echo "edge:$S:idle:st:tt{do: y$i=0}"
+  echo "edge:$S:st:decide:tau{provided: y$i==$SA}"
+  echo "edge:$S:decide:async:tau{provided: trt$i<$TTRT}"
+  echo "edge:$S:decide:idle:rt{provided: trt$i>=$TTRT : do: trt$i=0}"
+  echo "edge:$S:async:idle:rt{do: trt$i=0}"
+done
+
+for i in `seq 1 $N`; do
+  echo "sync:Ring@tt$i:ST$i@tt"
+  echo "sync:Ring@rt$i:ST$i@rt"
+done
@@ -0,0 +1,46 @@
+#!/bin/sh
+# -*- coding: utf-8 -*-
+# Copyright (C) 2019 Laboratoire de Recherche et Développement de
+# l'Epita (LRDE).
+#
+# This file is part of TCLTL, a model checker for timed automata.
+#
+# TCLTL is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# TCLTL is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+# License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: fischer.sh N [K]
+#
+# Output a TChecker model of Fischer's mutual-exclusion protocol
+# with N processes and delay K.
+
+N=${1?missing number of processes}
+K=${2-10}
+
+echo "system:fischer_${N}_${K}"
+echo "event:tau"
+echo "int:1:0:$N:0:id"
+
+for i in `seq 1 $N`; do
+  P=P$i
+  echo "process:$P"
+  echo "clock:1:x$i"
+  echo "location:$P:A{initial:}"
+  echo "location:$P:req{invariant: x$i<=$K}"
+  echo "location:$P:wait{}"
+  echo "location:$P:cs{}"
+  echo "edge:$P:A:req:tau{provided: id==0 : do: x$i=0}"
+  echo "edge:$P:req:wait:tau{provided: x$i<=$K : do: x$i=0; id=$i}"
+  echo "edge:$P:wait:req:tau{provided: id==0 : do: x$i=0}"
+  echo "edge:$P:wait:cs:tau{provided: x$i>$K && id==$i}"
+  echo "edge:$P:cs:A:tau{do: id=0}"
+done
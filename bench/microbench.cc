@@ -0,0 +1,482 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Microbenchmarks for the hot paths of the Kripke structures built
+// by tc_model::kripke().  A sample of states is first collected by
+// exploring the model, and each operation is then timed on this
+// sample, so that the cost of the wrapper can be measured apart from
+// the exploration algorithm of Spot.
+//
+// With --overhead, the whole zone graph is instead explored twice:
+// once with TChecker's builder alone, and once through tcltl_kripke,
+// in order to estimate how much time the adaptation layer costs per
+// state.  Both explorations use the default zone semantics of tcltl.
+//
+// Usage: microbench MODEL [SAMPLES]
+//        microbench --overhead MODEL
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <tchecker/parsing/parsing.hh>
+#include <tchecker/utils/log.hh>
+#include <tchecker/zg/zg_ta.hh>
+#include <tchecker/ts/allocators.hh>
+#include <tchecker/ts/builder.hh>
+
+#include <spot/twaalgos/reachiter.hh>
+
+#include "tcltl.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+static const char unit[] = "cycles/op";
+static inline uint64_t ticks()
+{
+  return __rdtsc();
+}
+#else
+static const char unit[] = "ns/op";
+static inline uint64_t ticks()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+// Each measure is repeated this many times, and the best run is kept.
+static const unsigned repeat = 5;
+
+static void report(const std::string& name, uint64_t ticks, unsigned long ops)
+{
+  std::cout << std::left << std::setw(40) << name << std::right
+            << std::setw(12) << std::fixed << std::setprecision(1)
+            << (ops ? double(ticks) / ops : 0.0) << ' ' << unit
+            << "  (" << ops << " ops)\n";
+}
+
+// Run BODY REPEAT times, and report the best run.  BODY should
+// return the number of operations it performed.
+template <typename F>
+static void measure(const std::string& name, F body)
+{
+  uint64_t best = UINT64_MAX;
+  unsigned long ops = 0;
+  for (unsigned r = 0; r < repeat; ++r)
+    {
+      uint64_t start = ticks();
+      ops = body();
+      uint64_t t = ticks() - start;
+      if (t < best)
+        best = t;
+    }
+  report(name, best, ops);
+}
+
+// Collect up to N states of K, in DFS order.  The states are
+// returned with a reference that the caller must release.
+static std::vector<const spot::state*>
+collect_states(const spot::const_kripke_ptr& k, unsigned n)
+{
+  std::vector<const spot::state*> res;
+  std::unordered_set<const spot::state*,
+                     spot::state_ptr_hash, spot::state_ptr_equal> seen;
+  std::vector<const spot::state*> todo;
+  const spot::state* init = k->get_init_state();
+  seen.insert(init);
+  todo.push_back(init);
+  while (!todo.empty() && res.size() < n)
+    {
+      const spot::state* s = todo.back();
+      todo.pop_back();
+      res.push_back(s->clone());
+      for (auto i: k->succ(s))
+        {
+          const spot::state* d = i->dst();
+          if (seen.insert(d).second)
+            todo.push_back(d);
+          else
+            d->destroy();
+        }
+    }
+  for (auto s: seen)
+    s->destroy();
+  return res;
+}
+
+static void release_states(std::vector<const spot::state*>& states)
+{
+  for (auto s: states)
+    s->destroy();
+  states.clear();
+}
+
+// The names of all locations and variables of the model, as listed
+// by tc_model::dump_info().
+static std::vector<std::string> all_props(const tc_model& m)
+{
+  std::ostringstream os;
+  m.dump_info(os);
+  std::istringstream is(os.str());
+  std::vector<std::string> res;
+  std::string line;
+  while (std::getline(is, line))
+    if (line.compare(0, 2, "- ") == 0)
+      res.emplace_back(line.substr(2, line.find(' ', 2) - 2));
+  return res;
+}
+
+// Explore the zone graph of MODEL with TChecker only, using the
+// same allocators and builder as tcltl_kripke.  Return the number of
+// states, and add to the time spent computing successors and looking
+// up states in the hash table to SUCC_TIME and HASH_TIME.
+template <typename ZG>
+static unsigned long
+raw_explore(const tchecker::zg::ta::model_t& model,
+            unsigned long& transitions,
+            uint64_t& succ_time, uint64_t& hash_time)
+{
+  using state_t = typename ZG::shared_state_t;
+  using state_ptr_t = typename ZG::shared_state_ptr_t;
+  using state_allocator_t =
+    typename ZG::template state_pool_allocator_t<state_t>;
+  using transition_allocator_t =
+    typename ZG::template transition_singleton_allocator_t
+    <typename ZG::transition_t>;
+  using allocator_t =
+    tchecker::ts::allocator_t<state_allocator_t, transition_allocator_t>;
+  using builder_t =
+    tchecker::ts::builder_ok_t<typename ZG::ts_t, allocator_t>;
+
+  struct state_hash
+  {
+    size_t operator()(const state_ptr_t& s) const
+    {
+      return hash_value(*s);
+    }
+  };
+  struct state_equal
+  {
+    bool operator()(const state_ptr_t& a, const state_ptr_t& b) const
+    {
+      return *a == *b;
+    }
+  };
+
+  tchecker::gc_t unused_gc;
+  typename ZG::ts_t ts(model);
+  allocator_t allocator(unused_gc, std::make_tuple(model, 100000),
+                        std::tuple<>());
+  builder_t builder(ts, allocator);
+  std::unordered_set<state_ptr_t, state_hash, state_equal> seen;
+  std::vector<state_ptr_t> todo;
+
+  auto initial_range = builder.initial();
+  for (auto it = initial_range.begin(); !it.at_end(); ++it)
+    {
+      auto [st, trans] = *it;
+      if (seen.insert(st).second)
+        todo.push_back(st);
+    }
+  transitions = 0;
+  while (!todo.empty())
+    {
+      state_ptr_t s = todo.back();
+      todo.pop_back();
+      uint64_t t0 = ticks();
+      auto range = builder.outgoing(s);
+      for (auto it = range.begin(); !it.at_end(); ++it)
+        {
+          auto [st, trans] = *it;
+          ++transitions;
+          uint64_t t1 = ticks();
+          succ_time += t1 - t0;
+          if (seen.insert(st).second)
+            todo.push_back(st);
+          t0 = ticks();
+          hash_time += t0 - t1;
+        }
+      succ_time += ticks() - t0;
+    }
+  unsigned long states = seen.size();
+  todo.clear();
+  seen.clear();
+  return states;
+}
+
+// Count the states and transitions visited by Spot's DFS.
+class counting_dfs final: public spot::twa_reachable_iterator_depth_first
+{
+public:
+  counting_dfs(const spot::const_twa_ptr& a)
+    : twa_reachable_iterator_depth_first(a)
+  {
+  }
+
+  void process_state(const spot::state*, int, spot::twa_succ_iterator*)
+    override
+  {
+    ++states;
+  }
+
+  void process_link(const spot::state*, int, const spot::state*, int,
+                    const spot::twa_succ_iterator*) override
+  {
+    ++transitions;
+  }
+
+  unsigned long states = 0;
+  unsigned long transitions = 0;
+};
+
+static int overhead(const char* filename)
+{
+  using zg_t = tchecker::zg::ta::elapsed_extraLUplus_local_t;
+
+  std::ostringstream os;
+  tchecker::log_t log = &os;
+  std::unique_ptr<const tchecker::parsing::system_declaration_t>
+    sysdecl(tchecker::parsing::parse_system_declaration(filename, log));
+  if (!sysdecl)
+    throw std::runtime_error("System declaration could not be built.\n"
+                             + os.str());
+  tchecker::zg::ta::model_t model(*sysdecl, log);
+
+  unsigned long raw_transitions;
+  uint64_t raw_succ = 0;
+  uint64_t raw_hash = 0;
+  uint64_t start = ticks();
+  unsigned long raw_states =
+    raw_explore<zg_t>(model, raw_transitions, raw_succ, raw_hash);
+  uint64_t raw_total = ticks() - start;
+
+  // The same exploration through tcltl_kripke, with Spot's DFS.
+  auto dict = spot::make_bdd_dict();
+  tc_model m = tc_model::load(filename);
+  spot::atomic_prop_set none;
+  uint64_t spot_total;
+  unsigned long spot_states;
+  unsigned long spot_transitions;
+  {
+    counting_dfs dfs(m.kripke(&none, dict, spot::formula::tt(),
+                              elapsed_extraLUplus_local));
+    start = ticks();
+    dfs.run();
+    spot_total = ticks() - start;
+    spot_states = dfs.states;
+    spot_transitions = dfs.transitions;
+  }
+
+  // A hand-written DFS over tcltl_kripke, in which each call through
+  // the spot::kripke interface is timed.
+  uint64_t t_succ_iter = 0;
+  uint64_t t_cond = 0;
+  uint64_t t_iter = 0;
+  uint64_t t_dst = 0;
+  uint64_t t_hash = 0;
+  uint64_t t_destroy = 0;
+  {
+    spot::const_kripke_ptr k = m.kripke(&none, dict, spot::formula::tt(),
+                                        elapsed_extraLUplus_local);
+    std::unordered_set<const spot::state*,
+                       spot::state_ptr_hash, spot::state_ptr_equal> seen;
+    std::vector<const spot::state*> todo;
+    const spot::state* init = k->get_init_state();
+    seen.insert(init);
+    todo.push_back(init);
+    while (!todo.empty())
+      {
+        const spot::state* s = todo.back();
+        todo.pop_back();
+        uint64_t t0 = ticks();
+        auto it = k->succ_iter(s);
+        uint64_t t1 = ticks();
+        t_succ_iter += t1 - t0;
+        // succ_iter() already labels the state; label it once more to
+        // measure what the BDD operations cost.
+        k->state_condition(s);
+        uint64_t t2 = ticks();
+        t_cond += t2 - t1;
+        uint64_t t3 = ticks();
+        for (bool ok = it->first(); ok; ok = it->next())
+          {
+            uint64_t t4 = ticks();
+            t_iter += t4 - t3;
+            const spot::state* d = it->dst();
+            uint64_t t5 = ticks();
+            t_dst += t5 - t4;
+            bool fresh = seen.insert(d).second;
+            uint64_t t6 = ticks();
+            t_hash += t6 - t5;
+            if (fresh)
+              todo.push_back(d);
+            else
+              d->destroy();
+            t3 = ticks();
+            t_destroy += t3 - t6;
+          }
+        t_iter += ticks() - t3;
+        k->release_iter(it);
+      }
+    uint64_t t0 = ticks();
+    for (auto s: seen)
+      s->destroy();
+    t_destroy += ticks() - t0;
+  }
+
+  std::cout << "model: " << filename << '\n'
+            << "TChecker alone: " << raw_states << " states, "
+            << raw_transitions << " transitions\n"
+            << "tcltl + Spot DFS: " << spot_states << " states, "
+            << spot_transitions << " transitions\n\n";
+  std::cout << "per-state cost:\n";
+  unsigned long n = raw_states ? raw_states : 1;
+  report("TChecker alone", raw_total, n);
+  report("  successor computation", raw_succ, n);
+  report("  hash table", raw_hash, n);
+  report("tcltl + Spot DFS", spot_total, n);
+  report("overhead of the wrapper", spot_total > raw_total
+         ? spot_total - raw_total : 0, n);
+  std::cout << "\nbreakdown of a timed DFS through spot::kripke:\n";
+  report("  succ_iter()", t_succ_iter, n);
+  report("    state_condition() (BDD labels)", t_cond, n);
+  report("  dst()", t_dst, n);
+  report("  hash table (hash()+compare())", t_hash, n);
+  report("  destroy()", t_destroy, n);
+  report("  first()/next()", t_iter, n);
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc == 3 && std::string(argv[1]) == "--overhead")
+    {
+      try
+        {
+          return overhead(argv[2]);
+        }
+      catch (const std::exception& e)
+        {
+          std::cerr << argv[0] << ": " << e.what() << '\n';
+          return 2;
+        }
+    }
+  if (argc < 2)
+    {
+      std::cerr << "usage: " << argv[0] << " MODEL [SAMPLES]\n"
+                << "       " << argv[0] << " --overhead MODEL\n";
+      return 2;
+    }
+  unsigned samples = argc > 2 ? atoi(argv[2]) : 10000;
+
+  try
+    {
+      auto dict = spot::make_bdd_dict();
+      tc_model m = tc_model::load(argv[1]);
+      std::cerr << m.get_logs();
+
+      spot::atomic_prop_set none;
+      spot::const_kripke_ptr k = m.kripke(&none, dict);
+      auto states = collect_states(k, samples);
+      std::cout << "model: " << argv[1] << ", "
+                << states.size() << " sampled states\n";
+      unsigned sz = states.size();
+
+      volatile size_t sink = 0;
+      measure("tcltl_state::hash()", [&]() {
+          size_t h = 0;
+          for (auto s: states)
+            h ^= s->hash();
+          sink = sink + h;
+          return sz;
+        });
+      measure("tcltl_state::compare()", [&]() {
+          int c = 0;
+          for (unsigned i = 0; i < sz; ++i)
+            c += states[i]->compare(states[(i + 1) % sz]);
+          sink = sink + c;
+          return sz;
+        });
+      measure("succ_iter() + delete", [&]() {
+          for (auto s: states)
+            delete k->succ_iter(s);
+          return sz;
+        });
+      measure("succ_iter() + release_iter()", [&]() {
+          for (auto s: states)
+            k->release_iter(k->succ_iter(s));
+          return sz;
+        });
+      measure("dst() + destroy() + check_tofree()", [&]() {
+          unsigned long n = 0;
+          for (auto s: states)
+            {
+              // succ_iter() calls check_tofree(), so this also
+              // reclaims the states released at the previous step.
+              auto it = k->succ_iter(s);
+              for (it->first(); !it->done(); it->next())
+                {
+                  it->dst()->destroy();
+                  ++n;
+                }
+              k->release_iter(it);
+            }
+          return n;
+        });
+      release_states(states);
+      k = nullptr;
+
+      auto props = all_props(m);
+      for (unsigned np = 1;; np *= 2)
+        {
+          if (np > props.size())
+            np = props.size();
+          spot::atomic_prop_set aps;
+          for (unsigned i = 0; i < np; ++i)
+            aps.insert(spot::formula::ap(props[i]));
+          spot::const_kripke_ptr kp = m.kripke(&aps, dict);
+          auto st = collect_states(kp, samples);
+          std::ostringstream name;
+          name << "state_condition() with " << np << " props";
+          measure(name.str(), [&]() {
+              for (auto s: st)
+                kp->state_condition(s);
+              return st.size();
+            });
+          release_states(st);
+          if (np == props.size())
+            break;
+        }
+    }
+  catch (const std::exception& e)
+    {
+      std::cerr << argv[0] << ": " << e.what() << '\n';
+      return 2;
+    }
+  return 0;
+}
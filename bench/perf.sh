@@ -0,0 +1,150 @@
+#!/bin/sh
+# -*- coding: utf-8 -*-
+# Copyright (C) 2019 Laboratoire de Recherche et Développement de
+# l'Epita (LRDE).
+#
+# This file is part of TCLTL, a model checker for timed automata.
+#
+# TCLTL is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# TCLTL is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+# License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: perf.sh check|record BASELINE
+#
+# Each line of BASELINE describes a workload (a benchmark family, its
+# size, a zone semantics, and a formula) along with its expected
+# numbers of states and transitions, and envelopes for its total time
+# (in seconds) and its peak RSS (in kB).
+#
+# "perf.sh check" runs every workload, and fails if the numbers of
+# states or transitions differ from the recorded ones.  Time and
+# memory depend on the machine, so they are only compared to their
+# envelopes when PERF_SLACK is set.  Workloads whose values have not
+# been recorded yet ("-") are skipped; if all of them are, the exit
+# status is 77, which Automake reports as a skipped test.
+#
+# "perf.sh record" rewrites BASELINE with the results of the current
+# build.  The envelopes are set to PERF_TIME_MARGIN (default 3) times
+# the measured time, but at least one second, and PERF_RSS_MARGIN
+# (default 1.5) times the measured peak RSS.
+#
+# The following environment variables may also be used:
+#   TCLTL       the tcltl binary to run
+#   PERF_SLACK  a factor applied to the envelopes when checking, for
+#               machines slower than the one that recorded them (use 1
+#               on that machine); unset, time and memory are not checked
+
+mode=${1?missing mode}
+baseline=${2?missing baseline}
+TCLTL=${TCLTL-tcltl}
+PERF_SLACK=${PERF_SLACK-}
+PERF_TIME_MARGIN=${PERF_TIME_MARGIN-3}
+PERF_RSS_MARGIN=${PERF_RSS_MARGIN-1.5}
+
+case $mode in
+  check|record);;
+  *) echo "$0: unknown mode $mode" >&2; exit 2;;
+esac
+
+srcdir=`dirname "$0"`
+srcdir=`cd "$srcdir" && pwd`
+tmpdir=`mktemp -d`
+trap 'rm -rf "$tmpdir"' 0
+
+# Extract a numeric field from the output of --stats=json.
+field()
+{
+  sed -n "s/.*\"$1\":\([-0-9.e+]*\).*/\1/p" "$tmpdir/stats.json"
+}
+phase()
+{
+  sed -n "s/.*\"$1\":{\"wall\":\([-0-9.e+]*\),.*/\1/p" "$tmpdir/stats.json"
+}
+
+# Succeed if $1 <= $2 * $3.
+within()
+{
+  awk -v val="$1" -v max="$2" -v k="$3" 'BEGIN { exit !(val <= max * k) }'
+}
+
+failures=0
+checked=0
+set -f
+while IFS= read -r line; do
+  case $line in
+    '#'*|'')
+      echo "$line" >> "$tmpdir/baseline"
+      continue;;
+  esac
+  set -- $line
+  family=$1 size=$2 sem=$3 states=$4 transitions=$5 time=$6 rss=$7
+  shift 7
+  formula="$*"
+  what="$family $size $sem '$formula'"
+
+  sh "$srcdir/$family.sh" $size > "$tmpdir/model.tc" </dev/null
+  $TCLTL -q --stats=json -z "$sem" "$tmpdir/model.tc" "$formula" \
+         2>"$tmpdir/stats.json" </dev/null
+  case $? in
+    0|1);;
+    *)
+      echo "FAIL: $what: tcltl failed" >&2
+      cat "$tmpdir/stats.json" >&2
+      failures=`expr $failures + 1`
+      continue;;
+  esac
+  s=`field states_generated`
+  t=`field transitions_generated`
+  r=`field peak_rss_kb`
+  d=`awk -v l="\`phase load\`" -v tr="\`phase translation\`" \
+         -v se="\`phase search\`" 'BEGIN { print l + tr + se }'`
+
+  if test $mode = record; then
+    time=`awk -v d="$d" -v k="$PERF_TIME_MARGIN" \
+              'BEGIN { t = int(d * k + 0.999); print t < 1 ? 1 : t }'`
+    rss=`awk -v r="$r" -v k="$PERF_RSS_MARGIN" \
+             'BEGIN { print int(r * k + 0.999) }'`
+    echo "$family $size $sem $s $t $time $rss $formula" \
+      >> "$tmpdir/baseline"
+    echo "$what: $s states, $t transitions, ${d}s, $r kB"
+    continue
+  fi
+
+  if test "$states" = - || test "$transitions" = -; then
+    echo "SKIP: $what: not recorded yet (run make perf-baseline)"
+    continue
+  fi
+  checked=`expr $checked + 1`
+  if test "$s" != "$states" || test "$t" != "$transitions"; then
+    echo "FAIL: $what: $s states and $t transitions," \
+         "expected $states and $transitions" >&2
+    echo "      (if this change is intended, run make perf-baseline)" >&2
+    failures=`expr $failures + 1`
+  fi
+  test -n "$PERF_SLACK" || continue
+  if test "$time" != - && ! within "$d" "$time" "$PERF_SLACK"; then
+    echo "FAIL: $what: took ${d}s, envelope is ${time}s" >&2
+    failures=`expr $failures + 1`
+  fi
+  if test "$rss" != - && ! within "$r" "$rss" "$PERF_SLACK"; then
+    echo "FAIL: $what: used $r kB, envelope is $rss kB" >&2
+    failures=`expr $failures + 1`
+  fi
+done < "$baseline"
+
+if test $mode = record; then
+  cp "$tmpdir/baseline" "$baseline"
+  exit 0
+fi
+test $failures -eq 0 || exit 1
+test $checked -gt 0 || exit 77
+exit 0
@@ -0,0 +1,141 @@
+#!/bin/sh
+# -*- coding: utf-8 -*-
+# Copyright (C) 2019 Laboratoire de Recherche et Développement de
+# l'Epita (LRDE).
+#
+# This file is part of TCLTL, a model checker for timed automata.
+#
+# TCLTL is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# TCLTL is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+# License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: run.sh [RESULTS]
+#
+# Run tcltl on each benchmark family at several sizes, under several
+# zone semantics and properties, and write one JSON object per run to
+# RESULTS (default: bench.jsonl).  The file is rewritten from scratch
+# so that the results of two releases can be compared with diff.
+#
+# The following environment variables may be used to tune the runs:
+#   TCLTL           the tcltl binary to benchmark
+#   BENCH_FAMILIES  the families to run
+#   BENCH_SIZES     override the sizes of all families
+#   BENCH_SEMANTICS the zone semantics to use
+#   BENCH_TIMEOUT   maximal time for each run, in seconds
+
+srcdir=`dirname "$0"`
+results=${1-bench.jsonl}
+TCLTL=${TCLTL-tcltl}
+BENCH_FAMILIES=${BENCH_FAMILIES-'critical-region fischer csmacd train-gate fddi'}
+BENCH_SEMANTICS=${BENCH_SEMANTICS-'elapsed:extraLU+l elapsed:extraM+l non-elapsed:extraLU+l'}
+BENCH_TIMEOUT=${BENCH_TIMEOUT-600}
+
+# Default sizes for each family.
+sizes()
+{
+  case $1 in
+    critical-region) echo 1 2 3;;
+    fischer) echo 2 3 4 5;;
+    csmacd) echo 2 3 4;;
+    train-gate) echo 2 3 4;;
+    fddi) echo 2 3 4 5;;
+  esac
+}
+
+# Properties for each family, one "name:formula" per line.  A
+# reachability property (safety) and a response property (liveness).
+properties()
+{
+  case $1 in
+    critical-region)
+      echo 'safety:G !prodcell1.error'
+      echo 'liveness:G(prodcell1.requesting -> F prodcell1.critical)';;
+    fischer)
+      echo 'safety:G !(P1.cs & P2.cs)'
+      echo 'liveness:G(P1.req -> F P1.cs)';;
+    csmacd)
+      echo 'safety:G !(S1.transm & S2.transm)'
+      echo 'liveness:G F Bus.idle';;
+    train-gate)
+      echo 'safety:G(Train1.in -> Gate.down)'
+      echo 'liveness:G(Train1.near -> F Train1.far)';;
+    fddi)
+      echo 'safety:G !(ST1.async & ST2.async)'
+      echo 'liveness:G F ST1.st';;
+  esac
+}
+
+if (timeout --version) >/dev/null 2>&1; then
+  run_timeout="timeout $BENCH_TIMEOUT"
+else
+  run_timeout=
+fi
+
+# Extract a numeric field from the output of --stats=json.
+field()
+{
+  sed -n "s/.*\"$1\":\([-0-9.e+]*\).*/\1/p" stats.json
+}
+phase()
+{
+  sed -n "s/.*\"$1\":{\"wall\":\([-0-9.e+]*\),.*/\1/p" stats.json
+}
+
+tmpdir=`mktemp -d`
+trap 'rm -rf "$tmpdir"' 0
+version=`$TCLTL --version | sed 1q`
+: > "$results"
+results=`cd "\`dirname "$results"\`" && pwd`/`basename "$results"`
+srcdir=`cd "$srcdir" && pwd`
+cd "$tmpdir"
+
+for family in $BENCH_FAMILIES; do
+  for n in ${BENCH_SIZES-`sizes $family`}; do
+    sh "$srcdir/$family.sh" $n > model.tc
+    properties $family | while IFS=: read prop formula; do
+      for sem in $BENCH_SEMANTICS; do
+        echo "$family $n $prop $sem" >&2
+        : > stats.json
+        $run_timeout $TCLTL -q --stats=json -z "$sem" model.tc "$formula" \
+                     2>stats.json </dev/null
+        case $? in
+          0) verdict=satisfied;;
+          1) verdict=violated;;
+          124) verdict=timeout;;
+          *) verdict=error;;
+        esac
+        states=`field states_generated`
+        transitions=`field transitions_generated`
+        rss=`field peak_rss_kb`
+        load=`phase load`
+        translation=`phase translation`
+        search=`phase search`
+        awk -v family="$family" -v n="$n" -v prop="$prop" -v sem="$sem" \
+            -v verdict="$verdict" -v version="$version" \
+            -v states="${states:-0}" -v transitions="${transitions:-0}" \
+            -v rss="${rss:-0}" -v load="${load:-0}" \
+            -v translation="${translation:-0}" -v search="${search:-0}" \
+        'BEGIN {
+           time = load + translation + search;
+           sps = search > 0 ? states / search : 0;
+           printf("{\"family\":\"%s\",\"size\":%d,\"property\":\"%s\",", \
+                  family, n, prop);
+           printf("\"semantics\":\"%s\",\"verdict\":\"%s\",", sem, verdict);
+           printf("\"states\":%d,\"transitions\":%d,", states, transitions);
+           printf("\"time\":%.3f,\"search_time\":%.3f,", time, search);
+           printf("\"states_per_sec\":%.0f,\"peak_rss_kb\":%d,", sps, rss);
+           printf("\"version\":\"%s\"}\n", version);
+         }' >> "$results"
+      done
+    done
+  done
+done
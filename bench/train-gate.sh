@@ -0,0 +1,85 @@
+#!/bin/sh
+# -*- coding: utf-8 -*-
+# Copyright (C) 2019 Laboratoire de Recherche et Développement de
+# l'Epita (LRDE).
+#
+# This file is part of TCLTL, a model checker for timed automata.
+#
+# TCLTL is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# TCLTL is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+# License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Usage: train-gate.sh N
+#
+# Output a TChecker model of N trains crossing a road protected by a
+# gate.  A controller counts the trains near the crossing, lowers the
+# gate when the first one approaches, and raises it when the last one
+# has left.
+
+N=${1?missing number of trains}
+
+echo "system:train_gate_${N}"
+echo "event:tau"
+echo "event:approach"
+echo "event:exit"
+echo "event:lower"
+echo "event:raise"
+for i in `seq 1 $N`; do
+  echo "event:approach$i"
+  echo "event:exit$i"
+done
+echo "int:1:0:$N:0:n"
+
+for i in `seq 1 $N`; do
+  T=Train$i
+  echo "process:$T"
+  echo "clock:1:x$i"
+  echo "location:$T:far{initial:}"
+  echo "location:$T:near{invariant: x$i<=5}"
+  echo "location:$T:in{invariant: x$i<=5}"
+  echo "edge:$T:far:near:approach{do: x$i=0}"
+  echo "edge:$T:near:in:tau{provided: x$i>2}"
+  echo "edge:$T:in:far:exit{}"
+done
+
+echo "process:Controller"
+echo "clock:1:z"
+echo "location:Controller:idle{initial:}"
+echo "location:Controller:closing{invariant: z<=1}"
+echo "location:Controller:opening{invariant: z<=1}"
+for i in `seq 1 $N`; do
+  echo "edge:Controller:idle:closing:approach$i{provided: n==0 : do: n=1; z=0}"
+  echo "edge:Controller:idle:idle:approach$i{provided: n>0 : do: n=n+1}"
+  echo "edge:Controller:closing:closing:approach$i{do: n=n+1}"
+  echo "edge:Controller:idle:opening:exit$i{provided: n==1 : do: n=0; z=0}"
+  echo "edge:Controller:idle:idle:exit$i{provided: n>1 : do: n=n-1}"
+done
+echo "edge:Controller:closing:idle:lower{}"
+echo "edge:Controller:opening:idle:raise{}"
+
+echo "process:Gate"
+echo "clock:1:y"
+echo "location:Gate:up{initial:}"
+echo "location:Gate:lowering{invariant: y<=1}"
+echo "location:Gate:down{}"
+echo "location:Gate:raising{invariant: y<=2}"
+echo "edge:Gate:up:lowering:lower{do: y=0}"
+echo "edge:Gate:lowering:down:tau{}"
+echo "edge:Gate:down:raising:raise{do: y=0}"
+echo "edge:Gate:raising:up:tau{provided: y>=1}"
+
+for i in `seq 1 $N`; do
+  echo "sync:Train$i@approach:Controller@approach$i"
+  echo "sync:Train$i@exit:Controller@exit$i"
+done
+echo "sync:Controller@lower:Gate@lower"
+echo "sync:Controller@raise:Gate@raise"
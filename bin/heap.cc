@@ -0,0 +1,138 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "config.h"
+#include "heap.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef HAVE_MALLOC_USABLE_SIZE
+#  include <malloc.h>
+#endif
+
+#ifdef HAVE_MALLOC_USABLE_SIZE
+
+// The counters may be updated by several threads (e.g., while a model
+// is loaded in the background), hence the atomics.  When counting is
+// off, the only cost of an allocation is a relaxed load.
+static std::atomic<bool> counting(false);
+// Net number of bytes allocated since heap_count_start().  Blocks
+// allocated before and freed after make it negative.
+static std::atomic<ptrdiff_t> in_use(0);
+static std::atomic<ptrdiff_t> peak(0);
+
+static void count_alloc(void* p)
+{
+  ptrdiff_t size = malloc_usable_size(p);
+  ptrdiff_t now = in_use.fetch_add(size, std::memory_order_relaxed) + size;
+  ptrdiff_t old = peak.load(std::memory_order_relaxed);
+  while (now > old
+         && !peak.compare_exchange_weak(old, now, std::memory_order_relaxed))
+    continue;
+}
+
+void* operator new(size_t size)
+{
+  if (size == 0)
+    size = 1;
+  void* p;
+  while (!(p = malloc(size)))
+    {
+      std::new_handler h = std::get_new_handler();
+      if (!h)
+        throw std::bad_alloc();
+      h();
+    }
+  if (counting.load(std::memory_order_relaxed))
+    count_alloc(p);
+  return p;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  if (p && counting.load(std::memory_order_relaxed))
+    in_use.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+  free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+  operator delete(p);
+}
+
+bool heap_count_supported()
+{
+  return true;
+}
+
+void heap_count_start()
+{
+  counting = false;
+  in_use = 0;
+  peak = 0;
+  counting = true;
+}
+
+void heap_count_stop()
+{
+  counting = false;
+}
+
+size_t heap_count_peak()
+{
+  return peak;
+}
+
+#else // !HAVE_MALLOC_USABLE_SIZE
+
+bool heap_count_supported()
+{
+  return false;
+}
+
+void heap_count_start()
+{
+}
+
+void heap_count_stop()
+{
+}
+
+size_t heap_count_peak()
+{
+  return 0;
+}
+
+#endif
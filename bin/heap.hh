@@ -0,0 +1,44 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+
+// Accounting of the memory allocated by operator new, for --mem-stats.
+//
+// bin/heap.cc replaces the global operator new and operator delete of
+// tcltl, so the allocations of Spot and TChecker are counted too.
+// The size of each block is the one reported by malloc_usable_size(),
+// so the rounding of malloc is included, but not its headers.
+// Counting is off until heap_count_start() is called.
+
+// Whether this build can count allocations.
+bool heap_count_supported();
+
+// Count allocations from now on, and reset the counters: blocks
+// allocated before this call are not counted when they are freed.
+void heap_count_start();
+
+// Stop counting.  The counters keep their values.
+void heap_count_stop();
+
+// Largest number of bytes allocated, and not freed, at any point
+// since heap_count_start().
+size_t heap_count_peak();
@@ -0,0 +1,272 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "config.h"
+#include "json.hh"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+std::string json_quote(const std::string& s)
+{
+  std::string res = "\"";
+  for (unsigned char c: s)
+    switch (c)
+      {
+      case '"':
+        res += "\\\"";
+        break;
+      case '\\':
+        res += "\\\\";
+        break;
+      case '\n':
+        res += "\\n";
+        break;
+      case '\t':
+        res += "\\t";
+        break;
+      default:
+        if (c < 0x20)
+          {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\u%04x", c);
+            res += buf;
+          }
+        else
+          {
+            res += c;
+          }
+        break;
+      }
+  return res + '"';
+}
+
+// A recursive-descent parser for json_parse_flat_object().
+class flat_json_parser
+{
+public:
+  flat_json_parser(const std::string& s,
+                   std::map<std::string, std::string>* raw)
+    : s_(s), raw_(raw)
+  {
+  }
+
+  std::map<std::string, std::string> parse()
+  {
+    std::map<std::string, std::string> res;
+    expect('{');
+    if (peek() == '}')
+      {
+        ++pos_;
+      }
+    else
+      {
+        for (;;)
+          {
+            std::string key = string();
+            expect(':');
+            peek();
+            size_t start = pos_;
+            res[key] = value();
+            if (raw_)
+              (*raw_)[key] = s_.substr(start, pos_ - start);
+            if (peek() == ',')
+              {
+                ++pos_;
+                continue;
+              }
+            expect('}');
+            break;
+          }
+      }
+    if (peek())
+      fail("trailing characters");
+    return res;
+  }
+
+private:
+  [[noreturn]] void fail(const char* what)
+  {
+    throw std::runtime_error(std::string("invalid JSON: ") + what
+                             + " at offset " + std::to_string(pos_));
+  }
+
+  // Return the next non-blank character, or 0 at the end.
+  char peek()
+  {
+    while (pos_ < s_.size() && isspace((unsigned char) s_[pos_]))
+      ++pos_;
+    return pos_ < s_.size() ? s_[pos_] : 0;
+  }
+
+  void expect(char c)
+  {
+    if (peek() != c)
+      fail((std::string("expected '") + c + '\'').c_str());
+    ++pos_;
+  }
+
+  // Append code point CP to RES in UTF-8.
+  static void utf8(std::string& res, unsigned cp)
+  {
+    if (cp < 0x80)
+      {
+        res += char(cp);
+      }
+    else if (cp < 0x800)
+      {
+        res += char(0xc0 | (cp >> 6));
+        res += char(0x80 | (cp & 0x3f));
+      }
+    else
+      {
+        res += char(0xe0 | (cp >> 12));
+        res += char(0x80 | ((cp >> 6) & 0x3f));
+        res += char(0x80 | (cp & 0x3f));
+      }
+  }
+
+  std::string string()
+  {
+    expect('"');
+    std::string res;
+    for (;;)
+      {
+        if (pos_ >= s_.size())
+          fail("unterminated string");
+        char c = s_[pos_++];
+        if (c == '"')
+          return res;
+        if (c != '\\')
+          {
+            res += c;
+            continue;
+          }
+        if (pos_ >= s_.size())
+          fail("unterminated string");
+        switch (char e = s_[pos_++])
+          {
+          case 'b':
+            res += '\b';
+            break;
+          case 'f':
+            res += '\f';
+            break;
+          case 'n':
+            res += '\n';
+            break;
+          case 'r':
+            res += '\r';
+            break;
+          case 't':
+            res += '\t';
+            break;
+          case 'u':
+            {
+              if (pos_ + 4 > s_.size())
+                fail("truncated \\u escape");
+              unsigned cp = 0;
+              for (int i = 0; i < 4; ++i)
+                {
+                  char h = s_[pos_++];
+                  if (!isxdigit((unsigned char) h))
+                    fail("invalid \\u escape");
+                  cp = cp * 16 + (isdigit((unsigned char) h) ? h - '0'
+                                  : (tolower((unsigned char) h) - 'a'
+                                     + 10));
+                }
+              utf8(res, cp);
+              break;
+            }
+          default:
+            res += e;
+            break;
+          }
+      }
+  }
+
+  std::string value()
+  {
+    char c = peek();
+    if (c == '"')
+      return string();
+    if (c == '{' || c == '[')
+      fail("nested values are not supported");
+    size_t start = pos_;
+    if (c == '-' || isdigit((unsigned char) c))
+      number();
+    else if (!literal("true") && !literal("false") && !literal("null"))
+      fail(c ? "invalid value" : "missing value");
+    return s_.substr(start, pos_ - start);
+  }
+
+  // Skip one or more digits.
+  void digits()
+  {
+    if (pos_ >= s_.size() || !isdigit((unsigned char) s_[pos_]))
+      fail("invalid number");
+    while (pos_ < s_.size() && isdigit((unsigned char) s_[pos_]))
+      ++pos_;
+  }
+
+  // Skip a number, following the JSON grammar.
+  void number()
+  {
+    if (s_[pos_] == '-')
+      ++pos_;
+    if (pos_ < s_.size() && s_[pos_] == '0')
+      ++pos_;
+    else
+      digits();
+    if (pos_ < s_.size() && s_[pos_] == '.')
+      {
+        ++pos_;
+        digits();
+      }
+    if (pos_ < s_.size() && (s_[pos_] == 'e' || s_[pos_] == 'E'))
+      {
+        ++pos_;
+        if (pos_ < s_.size() && (s_[pos_] == '+' || s_[pos_] == '-'))
+          ++pos_;
+        digits();
+      }
+  }
+
+  // Skip WORD if it comes next.
+  bool literal(const char* word)
+  {
+    if (s_.compare(pos_, strlen(word), word))
+      return false;
+    pos_ += strlen(word);
+    return true;
+  }
+
+  const std::string& s_;
+  std::map<std::string, std::string>* raw_;
+  size_t pos_ = 0;
+};
+
+std::map<std::string, std::string>
+json_parse_flat_object(const std::string& s,
+                       std::map<std::string, std::string>* raw)
+{
+  return flat_json_parser(s, raw).parse();
+}
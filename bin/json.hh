@@ -0,0 +1,39 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <map>
+#include <string>
+
+// Minimal JSON support for the line-based protocols of tcltl.
+
+// Return S as a JSON string, with quotes.
+std::string json_quote(const std::string& s);
+
+// Parse a JSON object whose values are strings, numbers, booleans, or
+// null, as found on one line of a request.  Strings are stored
+// unescaped, and other values as they are written.  Any other value,
+// including nested objects and arrays, is rejected.  If RAW is given,
+// it also receives each value as written in S, e.g., to echo it with
+// its JSON type.
+// On error, throw std::runtime_error.
+std::map<std::string, std::string>
+json_parse_flat_object(const std::string& s,
+                       std::map<std::string, std::string>* raw = nullptr);
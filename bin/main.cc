@@ -25,27 +25,74 @@
 #include "exitfail.h"
 #include "argmatch.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
 #include <spot/twaalgos/dot.hh>
 #include <spot/tl/parse.hh>
 #include <spot/tl/print.hh>
-#include <spot/twaalgos/translate.hh>
 #include <spot/twaalgos/emptiness.hh>
+#include <spot/twaalgos/stats.hh>
+#include <spot/twaalgos/gtec/gtec.hh>
+#include <spot/twa/twaproduct.hh>
+#include <bddx.h>
 
 #include "tcltl.hh"
+#include "heap.hh"
+#include "json.hh"
+#include "pool.hh"
+#include "query.hh"
+#include "trace.hh"
 
 static const char argp_program_doc[] ="\
 Check a timed-automaton against an LTL formula.\v\
 Exit status:\n\
   0  on success, or if the formula was verified\n\
   1  if the formula was violated (counter example found)\n\
-  2  if any error has been reported";
+  2  if any error has been reported\n\
+  3  if a resource limit was hit before the formula could be decided\n\n\
+Environment:\n\
+  TCLTL_CACHE_DIR  directory where the automata of translated formulas\n\
+                   are cached (default: ~/.cache/tcltl); set it to an\n\
+                   empty string to disable the cache";
 
 // argp's default behavior of offering -? for --help is just too silly.
 // We disable this option as well as -V (because --version doesn't need
 // a short version).
 enum {
-      OPT_DEAD = 256,
+      OPT_BATCH = 256,
+      OPT_BATCH_FORMAT,
+      OPT_COMPARE,
+      OPT_DEAD,
+      OPT_FAST_PARSER,
+      OPT_GENERATOR,
       OPT_HELP,
+      OPT_MAX_MEMORY,
+      OPT_MAX_STATES,
+      OPT_MEM_STATS,
+      OPT_PROGRESS,
+      OPT_SERVE,
+      OPT_STATS,
+      OPT_SWEEP,
+      OPT_TIMEOUT,
+      OPT_TRACE,
       OPT_VARS,
       OPT_VERSION,
 };
@@ -54,7 +101,11 @@ static const argp_option options[] =
   {
     { nullptr, 0, nullptr, 0, "Input:", 1 },
     { "model", 'm', "FILENAME", 0,
-      "read the timed-automaton model in FILENAME (TChecker's syntax)", 0 },
+      "read the timed-automaton model in FILENAME (TChecker's syntax), "
+      "or on standard input if FILENAME is \"-\"", 0 },
+    { "fast-parser", OPT_FAST_PARSER, nullptr, 0,
+      "parse the model with a faster parser for large generated models "
+      "(falling back to TChecker's parser on errors)", 0 },
     { "formula", 'f', "FORMULA", 0,
       "check the LTL on the model (Spot's syntax)", 0 },
     { nullptr, 0, nullptr, 0, "Output:", 2 },
@@ -64,6 +115,21 @@ static const argp_option options[] =
       "output the result in GraphViz format" },
     { "vars", OPT_VARS, nullptr, 0,
       "list variables in the model and exit", 0 },
+    { "mem-stats", OPT_MEM_STATS, nullptr, 0,
+      "print the peak memory used by the states of the model (estimated "
+      "from peak counts and the sizes of the structures), the sizes of "
+      "the emptiness check and of the BDD tables, and the measured peak "
+      "heap growth and RSS, on standard error", 0 },
+    { "progress", OPT_PROGRESS, "SECONDS", OPTION_ARG_OPTIONAL,
+      "report the progress of the exploration on standard error "
+      "every SECONDS (5 by default)", 0 },
+    { "stats", OPT_STATS, "json", OPTION_ARG_OPTIONAL,
+      "print timings and exploration statistics on standard error "
+      "(as a JSON object if \"json\" is given)", 0 },
+    { "trace", OPT_TRACE, "FILENAME", 0,
+      "write a timeline of the phases of the check in FILENAME, in "
+      "Chrome's trace-event format (for chrome://tracing or Perfetto)",
+      0 },
     { nullptr, 0, nullptr, 0, "Semantic options:", 3 },
     { "dead-loop", OPT_DEAD, "true|false|\"ap\"", 0,
       "handling of states without successors in the model: "
@@ -73,6 +139,50 @@ static const argp_option options[] =
     { "zone-semantics", 'z', "SEMANTICS", 0,
       "specify the zone semantics to use (\"elapsed:extraLU+l\" "
       "by default)", 0 },
+    { nullptr, 0, nullptr, 0, "Resource limits:", 4 },
+    { "max-states", OPT_MAX_STATES, "N", 0,
+      "stop exploring after visiting N states", 0 },
+    { "max-memory", OPT_MAX_MEMORY, "MB", 0,
+      "stop exploring once the process uses more than MB megabytes of "
+      "memory", 0 },
+    { "timeout", OPT_TIMEOUT, "SECONDS", 0,
+      "stop exploring after SECONDS; this also aborts each run of "
+      "--compare-semantics, and gives the default timeout of the queries "
+      "of --serve and --batch", 0 },
+    { nullptr, 0, nullptr, 0, "Comparison of zone semantics:", 5 },
+    { "compare-semantics", OPT_COMPARE, "SEMANTICS,...", OPTION_ARG_OPTIONAL,
+      "run the model (and the formula, if any) with each of the given "
+      "zone semantics (all of them by default), and print a table "
+      "comparing the results", 0 },
+    { "jobs", 'j', "N", 0,
+      "run at most N checks in parallel (default: number of processors)",
+      0 },
+    { nullptr, 0, nullptr, 0, "Parameter sweep:", 6 },
+    { "sweep", OPT_SWEEP, "[NAME=]FROM..TO", 0,
+      "check the instances of a parameterized model for each value of "
+      "NAME (\"N\" by default) from FROM to TO, in parallel, and print "
+      "how the state space grows; the model is a template in which "
+      "${NAME} stands for the value.  The sweep stops at the first "
+      "instance that violates the formula, or hits a limit", 0 },
+    { "generator", OPT_GENERATOR, "COMMAND", 0,
+      "with --sweep, read each instance from the output of the shell "
+      "COMMAND, run with the parameter in the environment variable NAME, "
+      "instead of a template", 0 },
+    { nullptr, 0, nullptr, 0, "Server and batch modes:", 7 },
+    { "batch", OPT_BATCH, "FILENAME", 0,
+      "run the jobs listed in the CSV file FILENAME, one per line, with "
+      "columns model,formula[,semantics[,timeout[,max_memory_mb]]], "
+      "and print one result per job; each model is loaded once for all "
+      "the jobs that use it", 0 },
+    { "batch-format", OPT_BATCH_FORMAT, "csv|json", 0,
+      "print the results of --batch as CSV (the default) or as JSON "
+      "lines", 0 },
+    { "serve", OPT_SERVE, "SOCKET", OPTION_ARG_OPTIONAL,
+      "answer JSON-lines queries read from standard input (or from "
+      "clients of the Unix SOCKET), keeping the models loaded and the "
+      "formulas translated between queries.  --jobs, --timeout, "
+      "--dead-loop, and --zone-semantics give the defaults for each "
+      "query", 0 },
     { nullptr, 0, nullptr, 0, "Miscellaneous options:", -1 },
     { "version", OPT_VERSION, nullptr, 0, "print program version", 0 },
     { "help", OPT_HELP, nullptr, 0, "print this help", 0 },
@@ -148,6 +258,67 @@ static spot::formula formula_neg;
 static std::string model_filename;
 static spot::formula dead_prop = spot::formula::tt();
 static zg_zone_semantics zone_sem = elapsed_extraLUplus_local;
+enum stats_type_t { STATS_NONE, STATS_TEXT, STATS_JSON };
+static stats_type_t stats_type = STATS_NONE;
+static bool compare_mode = false;
+static std::vector<zg_zone_semantics> compare_sems;
+static unsigned jobs = 0;
+static double timeout = 0.0;
+static unsigned long max_states = 0;
+static size_t max_memory = 0;
+static tc_budget budget;
+static double progress_period = 0.0;
+static bool mem_stats = false;
+static bool fast_parser = false;
+static bool serve_mode = false;
+static std::string batch_filename;
+static bool batch_json = false;
+static std::string serve_socket;
+static std::string trace_filename;
+static bool sweep_mode = false;
+static std::string sweep_param = "N";
+static unsigned long sweep_from = 0;
+static unsigned long sweep_to = 0;
+static std::string generator;
+static std::unique_ptr<trace_writer> trace = nullptr;
+
+// Wall-clock and CPU time spent in one phase of run().
+struct phase_time
+{
+  double wall = 0.0;
+  double cpu = 0.0;
+  bool measured = false;
+};
+
+// Measure a phase, and record it in the --trace timeline under NAME,
+// if NAME is given.
+class phase_timer
+{
+public:
+  phase_timer(phase_time& pt, const char* name = nullptr)
+    : pt_(pt), ts_(name ? trace.get() : nullptr, name),
+      wall_(std::chrono::steady_clock::now()), cpu_(std::clock())
+  {
+  }
+
+  ~phase_timer()
+  {
+    std::chrono::duration<double> w =
+      std::chrono::steady_clock::now() - wall_;
+    pt_.wall += w.count();
+    pt_.cpu += double(std::clock() - cpu_) / CLOCKS_PER_SEC;
+    pt_.measured = true;
+  }
+private:
+  phase_time& pt_;
+  tc_trace_scope ts_;
+  std::chrono::steady_clock::time_point wall_;
+  std::clock_t cpu_;
+};
+
+static phase_time load_time;
+static phase_time translation_time;
+static phase_time search_time;
 
 static void parse_formula(std::string f)
 {
@@ -160,6 +331,83 @@ static void parse_formula(std::string f)
   formula_neg = spot::formula::Not(pf.f);
 }
 
+static spot::formula parse_dead(const char* arg)
+{
+  if (!strcasecmp(arg, "true"))
+    return spot::formula::tt();
+  if (!strcasecmp(arg, "false"))
+    return spot::formula::ff();
+  return spot::formula::ap(arg);
+}
+
+static unsigned long
+to_ulong(const char* opt, const char* arg)
+{
+  char* endptr;
+  errno = 0;
+  unsigned long res = strtoul(arg, &endptr, 10);
+  if (!isdigit((unsigned char) *arg) || *endptr || errno)
+    error(2, 0, "Invalid argument for %s: %s", opt, arg);
+  return res;
+}
+
+// Convert ARG, a number of megabytes, into BYTES.  Return false if
+// ARG is not a non-negative integer, or if BYTES would overflow.
+static bool
+parse_megabytes(const char* arg, size_t& bytes)
+{
+  char* endptr;
+  errno = 0;
+  unsigned long res = strtoul(arg, &endptr, 10);
+  if (!isdigit((unsigned char) *arg) || *endptr || errno
+      || res > (SIZE_MAX >> 20))
+    return false;
+  bytes = size_t(res) << 20;
+  return true;
+}
+
+static size_t
+to_bytes(const char* opt, const char* arg)
+{
+  size_t res;
+  if (!parse_megabytes(arg, res))
+    error(2, 0, "Invalid argument for %s: %s", opt, arg);
+  return res;
+}
+
+static double
+to_seconds(const char* opt, const char* arg)
+{
+  char* endptr;
+  double res = strtod(arg, &endptr);
+  if (endptr == arg || *endptr || !(res > 0))
+    error(2, 0, "Invalid argument for %s: %s", opt, arg);
+  return res;
+}
+
+static void parse_sweep(const char* arg)
+{
+  std::string range = arg;
+  if (size_t eq = range.find('='); eq != std::string::npos)
+    {
+      sweep_param = range.substr(0, eq);
+      range = range.substr(eq + 1);
+    }
+  // The name must be usable as an environment variable by --generator.
+  bool valid =
+    !sweep_param.empty() && !isdigit((unsigned char) sweep_param[0]);
+  for (char c: sweep_param)
+    valid &= isalnum((unsigned char) c) || c == '_';
+  size_t dots = range.find("..");
+  if (!valid || dots == std::string::npos)
+    error(2, 0, "Invalid argument for --sweep: %s", arg);
+  sweep_from = to_ulong("--sweep", range.substr(0, dots).c_str());
+  sweep_to = to_ulong("--sweep", range.substr(dots + 2).c_str());
+  if (sweep_from > sweep_to)
+    error(2, 0, "Invalid argument for --sweep: %s", arg);
+  sweep_mode = true;
+}
+
 static int
 parse_opt(int key, char* arg, struct argp_state* state)
 {
@@ -172,6 +420,9 @@ parse_opt(int key, char* arg, struct argp_state* state)
     case 'f':
       parse_formula(arg);
       break;
+    case 'j':
+      jobs = to_ulong("--jobs", arg);
+      break;
     case 'm':
       if (!model_filename.empty())
         error(2, 0, "Only one model may be specified.");
@@ -184,13 +435,37 @@ parse_opt(int key, char* arg, struct argp_state* state)
       zone_sem = XARGMATCH("--zone-semantics", arg,
                            zone_sem_args, zone_sem_vals);
       break;
-    case OPT_DEAD:
-      if (!strcasecmp(arg, "true"))
-        dead_prop = spot::formula::tt();
-      else if (!strcasecmp(arg, "false"))
-        dead_prop = spot::formula::ff();
+    case OPT_BATCH:
+      batch_filename = arg;
+      break;
+    case OPT_BATCH_FORMAT:
+      if (!strcasecmp(arg, "csv"))
+        batch_json = false;
+      else if (!strcasecmp(arg, "json"))
+        batch_json = true;
       else
-        dead_prop = spot::formula::ap(arg);
+        error(2, 0, "Invalid argument for --batch-format: %s", arg);
+      break;
+    case OPT_COMPARE:
+      compare_mode = true;
+      if (arg)
+        {
+          std::istringstream is(arg);
+          std::string sem;
+          while (std::getline(is, sem, ','))
+            compare_sems.push_back(XARGMATCH("--compare-semantics",
+                                             sem.c_str(), zone_sem_args,
+                                             zone_sem_vals));
+        }
+      break;
+    case OPT_DEAD:
+      dead_prop = parse_dead(arg);
+      break;
+    case OPT_FAST_PARSER:
+      fast_parser = true;
+      break;
+    case OPT_GENERATOR:
+      generator = arg;
       break;
     case OPT_HELP:
       argp_state_help(state, state->out_stream,
@@ -201,6 +476,40 @@ parse_opt(int key, char* arg, struct argp_state* state)
       close_stdout();
       exit(0);
       break;
+    case OPT_MAX_MEMORY:
+      max_memory = to_bytes("--max-memory", arg);
+      break;
+    case OPT_MAX_STATES:
+      max_states = to_ulong("--max-states", arg);
+      break;
+    case OPT_MEM_STATS:
+      mem_stats = true;
+      break;
+    case OPT_PROGRESS:
+      progress_period = arg ? to_seconds("--progress", arg) : 5.0;
+      break;
+    case OPT_SERVE:
+      serve_mode = true;
+      if (arg)
+        serve_socket = arg;
+      break;
+    case OPT_STATS:
+      if (!arg)
+        stats_type = STATS_TEXT;
+      else if (!strcasecmp(arg, "json"))
+        stats_type = STATS_JSON;
+      else
+        error(2, 0, "Invalid argument for --stats: %s", arg);
+      break;
+    case OPT_SWEEP:
+      parse_sweep(arg);
+      break;
+    case OPT_TIMEOUT:
+      timeout = to_seconds("--timeout", arg);
+      break;
+    case OPT_TRACE:
+      trace_filename = arg;
+      break;
     case OPT_VARS:
       output_type = OUTPUT_VARS;
       break;
@@ -223,14 +532,1094 @@ parse_opt(int key, char* arg, struct argp_state* state)
   return 0;
 }
 
+// Peak resident set size of the process, in kilobytes.
+static long peak_rss_kb()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return -1;
+  return usage.ru_maxrss;
+}
+
+// Current resident set size of the process, in kilobytes.
+static long current_rss_kb()
+{
+  long pages = 0;
+  if (FILE* f = fopen("/proc/self/statm", "r"))
+    {
+      long size;
+      if (fscanf(f, "%ld %ld", &size, &pages) != 2)
+        pages = 0;
+      fclose(f);
+    }
+  if (pages <= 0)
+    return peak_rss_kb();
+  return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// Print the progress of the exploration for --progress.
+class progress_printer final: public tc_progress
+{
+public:
+  void report(const tc_kripke_stats& s, double elapsed) override
+  {
+    double rate = 0.0;
+    if (elapsed > last_elapsed_)
+      rate = (s.states_generated - last_states_) / (elapsed - last_elapsed_);
+    last_states_ = s.states_generated;
+    last_elapsed_ = elapsed;
+    std::cerr << program_name << ": " << std::fixed << std::setprecision(1)
+              << elapsed << "s, " << s.states_generated << " states ("
+              << std::setprecision(0) << rate << "/s), depth " << s.depth
+              << ", tofree " << s.tofree << ", rss " << current_rss_kb()
+              << " kB" << std::endl;
+  }
+private:
+  unsigned long last_states_ = 0;
+  double last_elapsed_ = 0.0;
+};
+
+static progress_printer progress;
+
+// Sample the exploration as counters of the --trace timeline, and
+// forward to the progress printer at the pace of --progress.
+class trace_progress final: public tc_progress
+{
+public:
+  trace_progress(const char* name)
+    : name_(name), next_print_(progress_period)
+  {
+  }
+
+  void report(const tc_kripke_stats& s, double elapsed) override
+  {
+    trace->counter(name_, {{"states", double(s.states_generated)},
+                           {"depth", double(s.depth)},
+                           {"tofree", double(s.tofree)}});
+    if (progress_period > 0 && elapsed >= next_print_)
+      {
+        progress.report(s, elapsed);
+        next_print_ = elapsed + progress_period;
+      }
+  }
+private:
+  const char* name_;
+  double next_print_;
+};
+
+// Period of the samples of trace_progress, in seconds.
+static const double trace_period = 0.05;
+
+// The timeout of the process_pool whose children call watch_kripke().
+// Their budget should stop them first, so that they report "unknown:
+// time limit reached" with their statistics.  Since the budget only
+// starts once the Kripke structure is built, and is only checked
+// every few hundred states, the pool waits a little longer before
+// killing a child that did not stop.
+static double check_pool_timeout()
+{
+  if (timeout <= 0)
+    return 0;
+  return timeout + std::max(1.0, timeout / 10);
+}
+
+// Install the progress reporting requested by --progress and --trace,
+// and the limits of --max-states, --max-memory, and --timeout, on K.
+// NAME is the name of the counters in the trace.
+static void watch_kripke(const spot::const_twa_ptr& k, const char* name)
+{
+  if (max_states || max_memory || timeout > 0)
+    {
+      budget.max_states = max_states;
+      budget.max_memory = max_memory;
+      budget.set_timeout(timeout);
+      set_kripke_budget(k, &budget);
+    }
+  if (trace)
+    {
+      static std::unique_ptr<trace_progress> tp;
+      tp = std::make_unique<trace_progress>(name);
+      set_kripke_progress(k, tp.get(), trace_period);
+    }
+  else if (progress_period > 0)
+    {
+      set_kripke_progress(k, &progress, progress_period);
+    }
+}
+
+// The Kripke structure whose counters --stats should display.
+static spot::const_twa_ptr stats_kripke = nullptr;
+
+static void print_stats(std::ostream& out, const spot::const_twa_ptr& k)
+{
+  static const std::pair<const char*, const phase_time*> phases[] = {
+    { "load", &load_time },
+    { "translation", &translation_time },
+    { "search", &search_time },
+  };
+  const tc_kripke_stats* ks = k ? kripke_stats(k) : nullptr;
+  static const tc_kripke_stats no_stats;
+  if (!ks)
+    ks = &no_stats;
+  const std::pair<const char*, unsigned long> counters[] = {
+    { "states_generated", ks->states_generated },
+    { "states_visited", ks->states_visited },
+    { "transitions_generated", ks->transitions_generated },
+    { "transitions_visited", ks->transitions_visited },
+    { "iterators_recycled", ks->iterators_recycled },
+    { "state_conditions", ks->state_conditions },
+    { "tofree_max", ks->tofree_max },
+  };
+  long rss = peak_rss_kb();
+
+  if (stats_type == STATS_JSON)
+    {
+      out << '{';
+      for (auto& [name, pt]: phases)
+        if (pt->measured)
+          out << '"' << name << "\":{\"wall\":" << pt->wall
+              << ",\"cpu\":" << pt->cpu << "},";
+      for (auto& [name, val]: counters)
+        out << '"' << name << "\":" << val << ',';
+      out << "\"peak_rss_kb\":" << rss << "}\n";
+      return;
+    }
+  for (auto& [name, pt]: phases)
+    if (pt->measured)
+      out << name << " time: " << pt->wall << "s wall, "
+          << pt->cpu << "s cpu\n";
+  for (auto& [name, val]: counters)
+    out << name << ": " << val << '\n';
+  out << "peak_rss: " << rss << " kB\n";
+}
+
+// Check K against AF (or just explore K if AF is nullptr) in a job of
+// process_pool, and describe the exploration in OUT for child_check.
+// Return 1 if the formula is violated, 3 if a limit was hit, and 0
+// otherwise.
+//
+// The states are those whose successors were computed
+// (states_visited), and the transitions those the search went
+// through (transitions_generated), whichever way the search ended.
+// (transitions_visited would not do: the product with AF steps
+// through the successors of a state of the zone graph once per
+// transition of AF.)
+// Without formula, these are exactly the states and edges of the
+// zone graph; with a formula, the zone graph is explored once per
+// state of the product with AF that the search reached.
+static int check_in_child(const spot::kripke_ptr& k,
+                          const spot::twa_graph_ptr& af, std::string& out)
+{
+  phase_time pt;
+  unsigned long states;
+  unsigned long transitions;
+  int verdict = 0;
+  std::string reason;
+  if (af)
+    {
+      tc_check_result r;
+      {
+        phase_timer t(pt, "emptiness check");
+        r = model_check(k, af);
+      }
+      verdict = r.verdict == verdict_violated;
+      if (r.verdict == verdict_unknown)
+        {
+          verdict = 3;
+          reason = r.reason;
+        }
+      states = r.stats.states_visited;
+      transitions = r.stats.transitions_generated;
+    }
+  else
+    {
+      {
+        phase_timer t(pt, "exploration");
+        spot::stats_reachable(k);
+      }
+      const tc_kripke_stats* ks = kripke_stats(k);
+      states = ks->states_visited;
+      transitions = ks->transitions_generated;
+      try
+        {
+          check_kripke_budget(k);
+        }
+      catch (const tc_budget_exceeded& e)
+        {
+          verdict = 3;
+          reason = e.what();
+          states = e.stats.states_visited;
+          transitions = e.stats.transitions_generated;
+        }
+    }
+  std::ostringstream os;
+  os << states << ' ' << transitions << ' ' << pt.wall << ' '
+     << peak_rss_kb() << ' ' << reason;
+  out = os.str();
+  return verdict;
+}
+
+// The description of an exploration by check_in_child().
+struct child_check
+{
+  unsigned long states = 0;
+  unsigned long transitions = 0;
+  double time = 0.0;
+  long rss = 0;
+  std::string reason;
+
+  child_check(const std::string& out)
+  {
+    std::istringstream is(out);
+    is >> states >> transitions >> time >> rss >> std::ws;
+    std::getline(is, reason);
+  }
+};
+
+// Check the model with each semantics of compare_sems, in parallel,
+// and print a table of the results.  AF is the automaton of the
+// negated formula, or nullptr if we just explore the zone graph.
+static int compare_semantics(tc_model& m, const spot::bdd_dict_ptr& dict,
+                             const spot::twa_graph_ptr& af)
+{
+  if (compare_sems.empty())
+    compare_sems.assign(std::begin(zone_sem_vals), std::end(zone_sem_vals));
+  unsigned n = compare_sems.size();
+  std::vector<job_result> results(n);
+  spot::atomic_prop_set ap;
+  if (af)
+    spot::atomic_prop_collect(formula_neg, &ap);
+
+  // Each child appends its own events to the trace, on its own track
+  // (track 1 is used by the loading of the model), so the parent
+  // must not hold any unwritten event when forking.
+  tc_trace_scope ts(trace.get(), "compare");
+  if (trace)
+    trace->flush();
+  process_pool pool(jobs ? jobs : process_pool::default_jobs(),
+                    check_pool_timeout());
+  for (unsigned i = 0; i < n; ++i)
+    pool.submit([&, i](std::string& out) {
+        const char* name = zone_sem_args[compare_sems[i]];
+        struct flush_trace
+        {
+          ~flush_trace()
+          {
+            if (trace)
+              trace->flush();
+          }
+        } ft;
+        if (trace)
+          trace->set_track(i + 2, name);
+        spot::kripke_ptr k;
+        {
+          tc_trace_scope ts(trace.get(), "kripke");
+          k = m.kripke(&ap, dict, dead_prop, compare_sems[i]);
+        }
+        watch_kripke(k, name);
+        return check_in_child(k, af, out);
+      }, [&results, i](const job_result& r) {
+        results[i] = r;
+      });
+  pool.wait_all();
+
+  int exit_code = 0;
+  std::ostringstream table;
+  table << std::left << std::setw(24) << "semantics" << std::right
+        << std::setw(12) << "states" << std::setw(14) << "transitions"
+        << std::setw(10) << "time(s)" << std::setw(12) << "rss(kB)"
+        << "  verdict\n";
+  for (unsigned i = 0; i < n; ++i)
+    {
+      const job_result& r = results[i];
+      table << std::left << std::setw(24)
+            << zone_sem_args[compare_sems[i]] << std::right;
+      if (r.status != job_result::JOB_OK)
+        {
+          table << std::setw(12) << '-' << std::setw(14) << '-'
+                << std::setw(10) << std::fixed << std::setprecision(3)
+                << r.wall << std::setw(12) << '-' << "  ";
+          switch (r.status)
+            {
+            case job_result::JOB_TIMEOUT:
+              table << "timeout\n";
+              if (exit_code == 0)
+                exit_code = 3;
+              break;
+            case job_result::JOB_MEMOUT:
+              table << "out of memory\n";
+              if (exit_code == 0)
+                exit_code = 3;
+              break;
+            default:
+              table << "error: " << r.output << '\n';
+              exit_code = 2;
+              break;
+            }
+          continue;
+        }
+      child_check c(r.output);
+      table << std::setw(12) << c.states << std::setw(14) << c.transitions
+            << std::setw(10) << std::fixed << std::setprecision(3) << c.time
+            << std::setw(12) << c.rss << "  ";
+      if (r.exit_code == 3)
+        table << "unknown: " << c.reason << '\n';
+      else if (!af)
+        table << "-\n";
+      else if (r.exit_code)
+        table << "violated\n";
+      else
+        table << "satisfied\n";
+      // A violation is conclusive, even if other runs were not.
+      if (r.exit_code == 1 && exit_code != 2)
+        exit_code = 1;
+      else if (r.exit_code == 3 && exit_code == 0)
+        exit_code = 3;
+    }
+  if (output_type != OUTPUT_QUIET)
+    std::cout << table.str();
+  return exit_code;
+}
+
+// Statistics of the last emptiness check.
+static unsigned ec_states = 0;
+static unsigned ec_transitions = 0;
+static unsigned ec_max_depth = 0;
+
+// Check the product of K and AF for emptiness, and return an
+// accepting run projected on K, or nullptr.  This is what
+// twa::intersecting_run() does, but instantiating Couvreur's
+// emptiness check ourselves gives us access to its statistics.
+// KRIPKE is the Kripke structure whose budget applies (K itself, or
+// the structure K was built from); this throws tc_budget_exceeded if
+// it cut the search short.
+static spot::twa_run_ptr
+find_run(const spot::const_twa_ptr& k, const spot::const_twa_ptr& af,
+         const spot::const_twa_ptr& kripke)
+{
+  if (mem_stats)
+    heap_count_start();
+  auto ec = spot::couvreur99(spot::otf_product(k, af));
+  spot::emptiness_check_result_ptr res;
+  {
+    tc_trace_scope ts(trace.get(), "emptiness check");
+    res = ec->check();
+  }
+  heap_count_stop();
+  if (const spot::unsigned_statistics* s = ec->statistics())
+    {
+      ec_states = s->get("states");
+      ec_transitions = s->get("transitions");
+      ec_max_depth = s->get("max. depth");
+    }
+  check_kripke_budget(kripke);
+  if (!res)
+    return nullptr;
+  // Building the counterexample explores part of the product again,
+  // which the budget should not interrupt.
+  set_kripke_budget(kripke, nullptr);
+  tc_trace_scope ts(trace.get(), "counterexample");
+  return res->accepting_run()->project(k);
+}
+
+// Print the memory usage of each component for --mem-stats.
+static void print_mem_stats(std::ostream& out, const spot::const_twa_ptr& k)
+{
+  tc_kripke_memory km = k ? kripke_memory(k) : tc_kripke_memory();
+  auto kb = [](size_t bytes) { return (bytes + 1023) / 1024; };
+  // The structures of the emptiness check and of BuDDy are private
+  // to Spot, so only their sizes in states and nodes are known.
+  out << "estimated peak memory usage (kB):\n"
+      << "  TChecker states: " << kb(km.tchecker_used)
+      << " (" << km.tchecker_state_bytes << " bytes/state, "
+      << kb(km.tchecker_reserved) << " reserved by the pools)\n"
+      << "  statepool_: " << kb(km.statepool) << '\n'
+      << "  tofree_ backlog: " << kb(km.tofree) << '\n'
+      << "emptiness check: " << ec_states << " states, max. depth "
+      << ec_max_depth << '\n'
+      << "BDD nodes: " << bdd_getnodenum() << " used, "
+      << bdd_getallocnum() << " allocated\n";
+  if (heap_count_supported())
+    out << "peak heap growth during the search (measured): "
+        << kb(heap_count_peak()) << " kB\n";
+  out << "peak RSS (measured): " << peak_rss_kb() << " kB\n";
+}
+
+// A client of --serve, reading requests from IN and writing
+// responses to OUT.
+struct serve_client
+{
+  int in;
+  int out;
+  // Data read but not yet processed.
+  std::string buffer;
+  bool eof = false;
+  // Number of queries whose response has not been sent.
+  unsigned pending = 0;
+};
+typedef std::shared_ptr<serve_client> serve_client_ptr;
+
+// ID is the "id" of the request as written in JSON, so that it is
+// echoed with its type.
+static void serve_reply(const serve_client_ptr& c, const std::string& id,
+                        const std::string& body)
+{
+  // The client may have hung up, but that should not kill the server.
+  write_all(c->out, "{\"id\":" + id + body + "}\n");
+}
+
+static std::string serve_result(const query_result& r)
+{
+  std::ostringstream os;
+  os << ",\"verdict\":\"" << query_result::verdict_name(r.verdict) << '"';
+  if (r.verdict == query_result::ERROR)
+    os << ",\"error\":" << json_quote(r.error);
+  else
+    os << ",\"states\":" << r.states << ",\"transitions\":" << r.transitions;
+  os << ",\"time\":" << r.time << ",\"search_time\":" << r.search_time
+     << ",\"cached_model\":" << (r.cached_model ? "true" : "false")
+     << ",\"cached_automaton\":" << (r.cached_automaton ? "true" : "false");
+  return os.str();
+}
+
+// Process one request of client C.  Set SHUTDOWN if it asks so.
+static void serve_request(query_engine& qe, const serve_client_ptr& c,
+                          const std::string& line, bool& shutdown)
+{
+  // Requests without id, or that cannot be parsed, get an empty one.
+  std::string id = "\"\"";
+  try
+    {
+      std::map<std::string, std::string> raw;
+      auto req = json_parse_flat_object(line, &raw);
+      if (auto it = raw.find("id"); it != raw.end())
+        id = it->second;
+      std::string cmd = req.count("cmd") ? req["cmd"] : "check";
+      if (cmd == "shutdown")
+        {
+          shutdown = true;
+          serve_reply(c, id, ",\"status\":\"ok\"");
+          return;
+        }
+      if (cmd == "stats")
+        {
+          std::ostringstream os;
+          os << ",\"models\":" << qe.models_cached()
+             << ",\"automata\":" << qe.automata_cached()
+             << ",\"running\":" << qe.pool().running();
+          serve_reply(c, id, os.str());
+          return;
+        }
+      if (cmd == "forget")
+        {
+          qe.forget_model(req["model"]);
+          serve_reply(c, id, ",\"status\":\"ok\"");
+          return;
+        }
+      if (cmd != "check")
+        throw std::runtime_error("unknown command: " + cmd);
+
+      query q;
+      q.model = req["model"];
+      q.formula = req["formula"];
+      if (q.model.empty())
+        throw std::runtime_error("missing model");
+      if (q.formula.empty())
+        throw std::runtime_error("missing formula");
+      q.semantics = zone_sem;
+      if (auto it = req.find("semantics"); it != req.end())
+        {
+          ptrdiff_t i = argmatch(it->second.c_str(), zone_sem_args,
+                                 zone_sem_vals, sizeof *zone_sem_vals);
+          if (i < 0)
+            throw std::runtime_error("invalid semantics: " + it->second);
+          q.semantics = zone_sem_vals[i];
+        }
+      q.dead = dead_prop;
+      if (auto it = req.find("dead"); it != req.end())
+        q.dead = parse_dead(it->second.c_str());
+      q.timeout = timeout;
+      if (auto it = req.find("timeout"); it != req.end())
+        q.timeout = std::stod(it->second);
+      if (auto it = req.find("max_memory_mb"); it != req.end())
+        if (!parse_megabytes(it->second.c_str(), q.max_memory))
+          throw std::invalid_argument("max_memory_mb");
+
+      ++c->pending;
+      qe.submit(q, [c, id](const query_result& r) {
+          --c->pending;
+          serve_reply(c, id, serve_result(r));
+        });
+    }
+  catch (const std::logic_error&)
+    {
+      // std::stod() and std::stoul() failures.
+      serve_reply(c, id, ",\"verdict\":\"error\",\"error\":"
+                  "\"invalid number\"");
+    }
+  catch (const std::exception& e)
+    {
+      serve_reply(c, id, ",\"verdict\":\"error\",\"error\":"
+                  + json_quote(e.what()));
+    }
+}
+
+// Answer queries from standard input, or from the clients of
+// SOCKET_PATH, until the input is exhausted or a client requests a
+// shutdown.  Each request is a JSON object on one line, and each
+// response is a JSON object on one line, with the same "id".
+// Responses may come in any order.
+static int serve(const std::string& socket_path)
+{
+  // Writing to a client that has hung up should not kill the server.
+  signal(SIGPIPE, SIG_IGN);
+  query_engine qe(jobs ? jobs : process_pool::default_jobs(), fast_parser);
+  std::vector<serve_client_ptr> clients;
+  int listen_fd = -1;
+  if (socket_path.empty())
+    {
+      clients.push_back(std::make_shared<serve_client>());
+      clients.back()->in = 0;
+      clients.back()->out = 1;
+    }
+  else
+    {
+      sockaddr_un addr = {};
+      addr.sun_family = AF_UNIX;
+      if (socket_path.size() >= sizeof addr.sun_path)
+        error(2, 0, "socket name too long: %s", socket_path.c_str());
+      strcpy(addr.sun_path, socket_path.c_str());
+      listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (listen_fd < 0)
+        error(2, errno, "socket");
+      // Replace a socket left over by a previous server, but no other
+      // kind of file.
+      struct stat st;
+      if (lstat(socket_path.c_str(), &st) == 0)
+        {
+          if (!S_ISSOCK(st.st_mode))
+            error(2, EADDRINUSE, "cannot listen on %s",
+                  socket_path.c_str());
+          unlink(socket_path.c_str());
+        }
+      if (bind(listen_fd, (sockaddr*) &addr, sizeof addr)
+          || listen(listen_fd, 16))
+        error(2, errno, "cannot listen on %s", socket_path.c_str());
+    }
+
+  bool shutdown = false;
+  for (;;)
+    {
+      // Handle the complete requests received so far, as long as
+      // some worker is free.
+      for (auto& c: clients)
+        while (!shutdown && qe.pool().available())
+          {
+            size_t eol = c->buffer.find('\n');
+            if (eol == std::string::npos)
+              {
+                if (!c->eof || c->buffer.empty())
+                  break;
+                eol = c->buffer.size();
+              }
+            std::string line = c->buffer.substr(0, eol);
+            c->buffer.erase(0, eol + 1);
+            if (line.find_first_not_of(" \t\r") != std::string::npos)
+              serve_request(qe, c, line, shutdown);
+          }
+      // Forget the clients that have nothing left to do.
+      for (unsigned i = clients.size(); i-- > 0;)
+        {
+          serve_client_ptr& c = clients[i];
+          if ((c->eof || shutdown) && c->pending == 0
+              && (shutdown || c->buffer.empty()))
+            {
+              if (c->in > 1)
+                close(c->in);
+              clients.erase(clients.begin() + i);
+            }
+        }
+      if ((shutdown || (listen_fd < 0 && clients.empty()))
+          && qe.pool().running() == 0)
+        break;
+
+      std::vector<pollfd> pfds;
+      if (listen_fd >= 0 && !shutdown)
+        pfds.push_back({listen_fd, POLLIN, 0});
+      unsigned first_client = pfds.size();
+      for (auto& c: clients)
+        pfds.push_back({(c->eof || shutdown) ? -1 : c->in, POLLIN, 0});
+      unsigned first_job = pfds.size();
+      int delay = qe.pool().prepare_poll(pfds);
+      if (poll(pfds.data(), pfds.size(), delay) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          error(2, errno, "poll");
+        }
+      if (first_client > 0 && pfds[0].revents)
+        {
+          int fd = accept(listen_fd, nullptr, nullptr);
+          if (fd >= 0)
+            {
+              clients.push_back(std::make_shared<serve_client>());
+              clients.back()->in = clients.back()->out = fd;
+            }
+        }
+      for (unsigned i = first_client; i < first_job; ++i)
+        if (pfds[i].revents)
+          {
+            serve_client_ptr& c = clients[i - first_client];
+            char buf[65536];
+            ssize_t n = read(c->in, buf, sizeof buf);
+            if (n > 0)
+              c->buffer.append(buf, n);
+            else if (n == 0 || errno != EINTR)
+              c->eof = true;
+          }
+      // This may call the callbacks of the queries, but they do not
+      // change the list of clients.
+      qe.pool().process_poll(pfds, first_job);
+    }
+  if (listen_fd >= 0)
+    {
+      close(listen_fd);
+      unlink(socket_path.c_str());
+    }
+  return 0;
+}
+
+// Split a line of CSV into fields.  Fields may be quoted with double
+// quotes, in which case "" stands for one quote.
+static std::vector<std::string> csv_split(const std::string& line)
+{
+  std::vector<std::string> res(1);
+  bool quoted = false;
+  for (size_t i = 0; i < line.size(); ++i)
+    {
+      char c = line[i];
+      if (quoted)
+        {
+          if (c != '"')
+            res.back() += c;
+          else if (i + 1 < line.size() && line[i + 1] == '"')
+            res.back() += line[++i];
+          else
+            quoted = false;
+        }
+      else if (c == '"')
+        {
+          quoted = true;
+        }
+      else if (c == ',')
+        {
+          res.emplace_back();
+        }
+      else if (c != '\r')
+        {
+          res.back() += c;
+        }
+    }
+  return res;
+}
+
+static std::string csv_quote(const std::string& s)
+{
+  if (s.find_first_of(",\"\n") == std::string::npos)
+    return s;
+  std::string res = "\"";
+  for (char c: s)
+    {
+      if (c == '"')
+        res += '"';
+      res += c;
+    }
+  return res + '"';
+}
+
+// Run the jobs of the CSV file FILENAME, and print their results as
+// soon as they are known.
+static int batch(const std::string& filename)
+{
+  std::ifstream in(filename);
+  if (!in)
+    error(2, errno, "cannot open %s", filename.c_str());
+
+  struct batch_job
+  {
+    unsigned line;
+    query q;
+    std::string semantics;
+  };
+  std::vector<batch_job> batch_jobs;
+  std::string line;
+  for (unsigned n = 1; std::getline(in, line); ++n)
+    {
+      std::vector<std::string> f = csv_split(line);
+      if (f.size() == 1 && f[0].empty())
+        continue;
+      // Skip a header.
+      if (n == 1 && f.size() >= 2 && f[0] == "model" && f[1] == "formula")
+        continue;
+      if (f.size() < 2 || f.size() > 5)
+        error(2, 0, "%s:%u: expected 2 to 5 fields, not %zu",
+              filename.c_str(), n, f.size());
+      batch_job j = { n, query(), "" };
+      j.q.model = f[0];
+      j.q.formula = f[1];
+      j.q.semantics = zone_sem;
+      if (f.size() > 2 && !f[2].empty())
+        {
+          ptrdiff_t i = argmatch(f[2].c_str(), zone_sem_args,
+                                 zone_sem_vals, sizeof *zone_sem_vals);
+          if (i < 0)
+            error(2, 0, "%s:%u: invalid semantics: %s",
+                  filename.c_str(), n, f[2].c_str());
+          j.q.semantics = zone_sem_vals[i];
+        }
+      j.semantics = zone_sem_args[j.q.semantics];
+      j.q.dead = dead_prop;
+      j.q.timeout = timeout;
+      if (f.size() > 3 && !f[3].empty())
+        j.q.timeout = to_seconds("the timeout column", f[3].c_str());
+      if (f.size() > 4 && !f[4].empty())
+        j.q.max_memory = to_bytes("the max_memory_mb column",
+                                  f[4].c_str());
+      batch_jobs.push_back(std::move(j));
+    }
+
+  // Group the jobs by model, so that each model only has to be kept in
+  // memory while its jobs are being started.
+  std::map<std::string, unsigned> model_order;
+  std::map<std::string, unsigned> model_jobs;
+  for (auto& j: batch_jobs)
+    {
+      model_order.emplace(j.q.model, model_order.size());
+      ++model_jobs[j.q.model];
+    }
+  std::stable_sort(batch_jobs.begin(), batch_jobs.end(),
+                   [&](const batch_job& a, const batch_job& b) {
+                     return model_order[a.q.model] < model_order[b.q.model];
+                   });
+
+  if (output_type != OUTPUT_QUIET && !batch_json)
+    std::cout << "line,model,formula,semantics,verdict,states,transitions,"
+              << "time,search_time,error\n";
+  int exit_code = 0;
+  query_engine qe(jobs ? jobs : process_pool::default_jobs(), fast_parser);
+  for (auto& j: batch_jobs)
+    {
+      qe.submit(j.q, [&exit_code, &j](const query_result& r) {
+          // As with --compare-semantics, a violation is conclusive
+          // even if other jobs were not.
+          if (r.verdict == query_result::ERROR)
+            exit_code = 2;
+          else if (r.verdict == query_result::VIOLATED && exit_code != 2)
+            exit_code = 1;
+          else if ((r.verdict == query_result::TIMEOUT
+                    || r.verdict == query_result::MEMOUT)
+                   && exit_code == 0)
+            exit_code = 3;
+          if (output_type == OUTPUT_QUIET)
+            return;
+          const char* verdict = query_result::verdict_name(r.verdict);
+          if (batch_json)
+            std::cout << "{\"line\":" << j.line
+                      << ",\"model\":" << json_quote(j.q.model)
+                      << ",\"formula\":" << json_quote(j.q.formula)
+                      << ",\"semantics\":\"" << j.semantics
+                      << "\"" << serve_result(r) << "}\n";
+          else
+            std::cout << j.line << ',' << csv_quote(j.q.model) << ','
+                      << csv_quote(j.q.formula) << ',' << j.semantics << ','
+                      << verdict << ',' << r.states << ',' << r.transitions
+                      << ',' << r.time << ',' << r.search_time << ','
+                      << csv_quote(r.error) << '\n';
+          std::cout.flush();
+        });
+      if (--model_jobs[j.q.model] == 0)
+        qe.forget_model(j.q.model);
+    }
+  qe.pool().wait_all();
+  return exit_code;
+}
+
+// Replace each ${sweep_param} of TEXT by N.
+static std::string instantiate(const std::string& text, unsigned long n)
+{
+  std::string var = "${" + sweep_param + "}";
+  std::string val = std::to_string(n);
+  std::string res;
+  size_t pos = 0;
+  for (size_t i; (i = text.find(var, pos)) != std::string::npos;
+       pos = i + var.size())
+    res.append(text, pos, i - pos).append(val);
+  return res.append(text, pos);
+}
+
+// Return the output of --generator, run with sweep_param set to N.
+// This is called in a child of process_pool, so the environment can
+// be changed.
+static std::string generate(unsigned long n)
+{
+  setenv(sweep_param.c_str(), std::to_string(n).c_str(), 1);
+  FILE* f = popen(generator.c_str(), "r");
+  if (!f)
+    throw std::runtime_error("cannot run " + generator + ": "
+                             + strerror(errno));
+  std::string text;
+  char buf[65536];
+  while (size_t r = fread(buf, 1, sizeof buf, f))
+    text.append(buf, r);
+  if (pclose(f) != 0)
+    throw std::runtime_error(generator + " failed for " + sweep_param
+                             + "=" + std::to_string(n));
+  return text;
+}
+
+// Check the instances of the model for each value of the --sweep
+// parameter, in parallel, and print a table of the results.  AF is
+// the automaton of the negated formula, or nullptr if we just explore
+// the zone graphs.
+//
+// The sweep stops at the first instance that does not satisfy the
+// formula: the instances after it are not started, or are killed if
+// they are running, and are not reported.
+static int sweep(const spot::bdd_dict_ptr& dict,
+                 const spot::twa_graph_ptr& af)
+{
+  std::string text;
+  if (generator.empty())
+    {
+      std::ostringstream os;
+      if (model_filename == "-")
+        {
+          os << std::cin.rdbuf();
+        }
+      else
+        {
+          std::ifstream in(model_filename);
+          if (!in)
+            error(2, errno, "cannot open %s", model_filename.c_str());
+          os << in.rdbuf();
+        }
+      text = os.str();
+      if (text.find("${" + sweep_param + "}") == std::string::npos)
+        error(2, 0, "%s does not mention ${%s}",
+              model_filename.c_str(), sweep_param.c_str());
+    }
+  spot::atomic_prop_set ap;
+  if (af)
+    spot::atomic_prop_collect(formula_neg, &ap);
+
+  unsigned long count = sweep_to - sweep_from + 1;
+  std::vector<job_result> results(count);
+  std::vector<pid_t> pids(count);
+  // Index of the first instance that stopped the sweep.
+  unsigned long stop = count;
+  if (trace)
+    trace->flush();
+  process_pool pool(jobs ? jobs : process_pool::default_jobs(),
+                    check_pool_timeout());
+  for (unsigned long i = 0; i < count && i < stop; ++i)
+    {
+      pids[i] = pool.submit([&, i](std::string& out) {
+          struct flush_trace
+          {
+            ~flush_trace()
+            {
+              if (trace)
+                trace->flush();
+            }
+          } ft;
+          unsigned long n = sweep_from + i;
+          std::string name = sweep_param + "=" + std::to_string(n);
+          if (trace)
+            trace->set_track(i + 2, name);
+          tc_model m = [&] {
+            tc_trace_scope ts(trace.get(), "load");
+            return tc_model::load_from_string(generator.empty()
+                                              ? instantiate(text, n)
+                                              : generate(n), fast_parser);
+          }();
+          std::string logs = m.get_logs();
+          if (!logs.empty())
+            std::cerr << logs;
+          spot::kripke_ptr k;
+          {
+            tc_trace_scope ts(trace.get(), "kripke");
+            k = m.kripke(&ap, dict, dead_prop, zone_sem);
+          }
+          watch_kripke(k, "exploration");
+          return check_in_child(k, af, out);
+        }, [&, i](const job_result& r) {
+          results[i] = r;
+          if (i < stop
+              && (r.status != job_result::JOB_OK || r.exit_code != 0))
+            {
+              stop = i;
+              for (unsigned long j = i + 1; j < count; ++j)
+                if (pids[j])
+                  pool.cancel(pids[j]);
+            }
+        });
+      // The callbacks run by submit() may have stopped the sweep
+      // before this instance was started.
+      if (stop < i)
+        pool.cancel(pids[i]);
+    }
+  pool.wait_all();
+
+  int exit_code = 0;
+  std::ostringstream table;
+  table << std::setw(10) << sweep_param << std::setw(12) << "states"
+        << std::setw(14) << "transitions" << std::setw(8) << "growth"
+        << std::setw(10) << "time(s)" << std::setw(12) << "rss(kB)"
+        << "  verdict\n";
+  unsigned long last_states = 0;
+  for (unsigned long i = 0; i < count && i <= stop; ++i)
+    {
+      const job_result& r = results[i];
+      table << std::setw(10) << sweep_from + i;
+      if (r.status != job_result::JOB_OK)
+        {
+          table << std::setw(12) << '-' << std::setw(14) << '-'
+                << std::setw(8) << '-' << std::setw(10) << std::fixed
+                << std::setprecision(3) << r.wall << std::setw(12) << '-'
+                << "  ";
+          switch (r.status)
+            {
+            case job_result::JOB_TIMEOUT:
+              table << "timeout\n";
+              exit_code = 3;
+              break;
+            case job_result::JOB_MEMOUT:
+              table << "out of memory\n";
+              exit_code = 3;
+              break;
+            default:
+              table << "error: " << r.output << '\n';
+              exit_code = 2;
+              break;
+            }
+          break;
+        }
+      child_check c(r.output);
+      table << std::setw(12) << c.states << std::setw(14) << c.transitions;
+      if (last_states)
+        table << std::setw(8) << std::fixed << std::setprecision(2)
+              << double(c.states) / last_states;
+      else
+        table << std::setw(8) << '-';
+      table << std::setw(10) << std::fixed << std::setprecision(3) << c.time
+            << std::setw(12) << c.rss << "  ";
+      last_states = c.states;
+      if (r.exit_code == 3)
+        table << "unknown: " << c.reason << '\n';
+      else if (!af)
+        table << "-\n";
+      else if (r.exit_code)
+        table << "violated\n";
+      else
+        table << "satisfied\n";
+      exit_code = r.exit_code;
+    }
+  if (output_type != OUTPUT_QUIET)
+    std::cout << table.str();
+  return exit_code;
+}
+
+// Report that a limit of --max-states, --max-memory, or --timeout
+// stopped the exploration, and how far it went.  This goes to
+// standard error if standard output holds a GraphViz graph.
+static int inconclusive(const tc_budget_exceeded& e)
+{
+  if (output_type == OUTPUT_QUIET)
+    return 3;
+  std::ostream& out = output_type == OUTPUT_DOT ? std::cerr : std::cout;
+  out << "inconclusive: " << e.what() << " after visiting "
+      << e.stats.states_visited << " states (" << e.stats.states_generated
+      << " generated, " << e.stats.transitions_generated
+      << " transitions), at depth " << e.stats.depth << '\n';
+  if (formula_neg)
+    out << "no counterexample was found in the explored part\n";
+  return 3;
+}
+
 static int run()
 {
+  if (!trace_filename.empty())
+    {
+      trace = std::make_unique<trace_writer>(trace_filename);
+      set_tcltl_trace(trace.get());
+    }
+  if (serve_mode)
+    {
+      if (!model_filename.empty() || formula_neg)
+        error(2, 0, "--serve does not take a model or a formula");
+      return serve(serve_socket);
+    }
+  if (!batch_filename.empty())
+    {
+      if (!model_filename.empty() || formula_neg)
+        error(2, 0, "--batch does not take a model or a formula");
+      return batch(batch_filename);
+    }
+  if (!generator.empty() && !sweep_mode)
+    error(2, 0, "--generator requires --sweep");
+  if (sweep_mode)
+    {
+      if (compare_mode)
+        error(2, 0, "--sweep and --compare-semantics are incompatible");
+      if (!generator.empty() && !model_filename.empty())
+        error(2, 0, "--generator does not take a model");
+      if (generator.empty() && model_filename.empty())
+        error(2, 0, "--sweep requires a model or --generator");
+      auto dict = spot::make_bdd_dict();
+      spot::twa_graph_ptr af = nullptr;
+      if (formula_neg)
+        {
+          phase_timer t(translation_time, "translation");
+          af = translate_cached(formula_neg, dict);
+        }
+      return sweep(dict, af);
+    }
+
+  auto load = [] {
+    phase_timer t(load_time, "load");
+    if (model_filename == "-")
+      return tc_model::load_from_stream(std::cin, fast_parser);
+    return tc_model::load(model_filename, fast_parser);
+  };
+  // Loading the model only involves TChecker, and translating the
+  // formula only involves Spot, so both can run at the same time.
+  // BuDDy is not thread-safe: everything that uses DICT, including
+  // the conversion of the propositions by kripke(), stays in this
+  // thread.  (The CPU times of the two phases are those of the whole
+  // process, so they include each other when they overlap.)
   auto dict = spot::make_bdd_dict();
-  tc_model m = tc_model::load(model_filename);
+  spot::twa_graph_ptr af = nullptr;
+  bool translate = formula_neg && (compare_mode || output_type != OUTPUT_VARS);
+  std::future<tc_model> loading;
+  if (translate)
+    loading = std::async(std::launch::async, [&] {
+        if (trace)
+          trace->set_track(1, "load");
+        return load();
+      });
+  if (translate)
+    {
+      phase_timer t(translation_time, "translation");
+      af = translate_cached(formula_neg, dict);
+    }
+  tc_model m = translate ? loading.get() : load();
   std::string logs = m.get_logs();
   if (!logs.empty())
     std::cerr << logs;
 
+  if (compare_mode)
+    return compare_semantics(m, dict, af);
+
   if (!formula_neg
       && output_type != OUTPUT_VARS
       && output_type != OUTPUT_DOT)
@@ -248,21 +1637,54 @@ static int run()
   if (!formula_neg && output_type == OUTPUT_DOT)
     {
       spot::atomic_prop_set ap;
-      auto k = m.kripke(&ap, dict, dead_prop, zone_sem);
+      spot::kripke_ptr k;
+      {
+        tc_trace_scope ts(trace.get(), "kripke");
+        k = m.kripke(&ap, dict, dead_prop, zone_sem);
+      }
+      stats_kripke = k;
+      watch_kripke(k, "exploration");
       k->set_named_prop("automaton-name", new std::string(model_filename));
-      spot::print_dot(std::cout, k, ".kvA");
+      phase_timer t(search_time, "exploration and output");
+      try
+        {
+          spot::print_dot(std::cout, k, ".kvA");
+          check_kripke_budget(k);
+        }
+      catch (const tc_budget_exceeded& e)
+        {
+          return inconclusive(e);
+        }
       return 0;
     }
 
-  spot::twa_graph_ptr af = spot::translator(dict).run(formula_neg);
   spot::atomic_prop_set ap;
   spot::atomic_prop_collect(formula_neg, &ap);
-  spot::twa_ptr k = m.kripke(&ap, dict, dead_prop, zone_sem);
-  if (output_type == OUTPUT_DOT)
-    k = spot::make_twa_graph(k, spot::twa::prop_set::all(), true);
-  int exit_code = 0;
-  auto run = k->intersecting_run(af);
-  exit_code = !!run;
+  spot::twa_ptr k = [&] {
+    tc_trace_scope ts(trace.get(), "kripke");
+    return m.kripke(&ap, dict, dead_prop, zone_sem);
+  }();
+  stats_kripke = k;
+  watch_kripke(k, "exploration");
+  spot::twa_run_ptr run;
+  try
+    {
+      phase_timer t(search_time, "search");
+      spot::const_twa_ptr kripke = k;
+      if (output_type == OUTPUT_DOT)
+        {
+          tc_trace_scope ts(trace.get(), "make_twa_graph");
+          k = spot::make_twa_graph(k, spot::twa::prop_set::all(), true);
+          check_kripke_budget(kripke);
+        }
+      run = find_run(k, af, kripke);
+    }
+  catch (const tc_budget_exceeded& e)
+    {
+      return inconclusive(e);
+    }
+  int exit_code = !!run;
+  tc_trace_scope ts(trace.get(), "output");
   switch (output_type)
     {
     case OUTPUT_STD:
@@ -322,9 +1744,19 @@ int main(int argc, char * argv[])
     exit_code = run();
   }
   catch (const std::exception& e) {
+    set_tcltl_trace(nullptr);
+    trace = nullptr;
     error(2, 0, "%s", e.what());
   }
 
+  if (stats_type != STATS_NONE)
+    print_stats(std::cerr, stats_kripke);
+  if (mem_stats)
+    print_mem_stats(std::cerr, stats_kripke);
+  stats_kripke = nullptr;
+  set_tcltl_trace(nullptr);
+  trace = nullptr;
+
   // Make sure we abort if we can't write to std::cout anymore
   // (like disk full or broken pipe with SIGPIPE ignored).
   std::cout.flush();
@@ -0,0 +1,300 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "config.h"
+#include "pool.hh"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// The child reports its status with one leading character, followed
+// by the exit code of the job on the first line, and then the output
+// of the job.
+static const char status_ok = 'O';
+static const char status_memout = 'M';
+static const char status_error = 'E';
+
+// Size of the address space of the process, or 0 if unknown.
+static size_t address_space_bytes()
+{
+  // The first field of /proc/self/statm is the total size, in pages.
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (!f)
+    return 0;
+  unsigned long total;
+  int n = fscanf(f, "%lu", &total);
+  fclose(f);
+  if (n != 1)
+    return 0;
+  return total * sysconf(_SC_PAGESIZE);
+}
+
+process_pool::process_pool(unsigned jobs, double timeout, size_t max_memory)
+  : jobs_(jobs ? jobs : 1), timeout_(timeout), max_memory_(max_memory)
+{
+}
+
+process_pool::~process_pool()
+{
+  for (child& c: running_)
+    {
+      kill(c.pid, SIGKILL);
+      close(c.fd);
+      waitpid(c.pid, nullptr, 0);
+    }
+}
+
+unsigned process_pool::default_jobs()
+{
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? n : 1;
+}
+
+bool write_all(int fd, const std::string& s)
+{
+  const char* p = s.data();
+  size_t n = s.size();
+  while (n)
+    {
+      ssize_t w = write(fd, p, n);
+      if (w < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return false;
+        }
+      p += w;
+      n -= w;
+    }
+  return true;
+}
+
+pid_t process_pool::submit(job_t job, callback_t done)
+{
+  return submit(std::move(job), std::move(done), timeout_, max_memory_);
+}
+
+pid_t process_pool::submit(job_t job, callback_t done,
+                           double timeout, size_t max_memory)
+{
+  while (running_.size() >= jobs_)
+    wait_some();
+
+  int fds[2];
+  if (pipe(fds))
+    throw std::runtime_error(std::string("pipe: ") + strerror(errno));
+  // Do not let the child flush a copy of our buffers.
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(nullptr);
+  pid_t pid = fork();
+  if (pid < 0)
+    {
+      close(fds[0]);
+      close(fds[1]);
+      throw std::runtime_error(std::string("fork: ") + strerror(errno));
+    }
+  if (pid == 0)
+    {
+      close(fds[0]);
+      for (child& c: running_)
+        close(c.fd);
+      if (max_memory)
+        {
+          // The child inherits the address space of the parent,
+          // including anything the parent caches (e.g., the models
+          // and automata of --serve).  Only limit what the job
+          // allocates on top of that.
+          struct rlimit rl;
+          rl.rlim_cur = rl.rlim_max = address_space_bytes() + max_memory;
+          setrlimit(RLIMIT_AS, &rl);
+        }
+      std::string out;
+      char status = status_ok;
+      int code = 0;
+      try
+        {
+          code = job(out);
+        }
+      catch (const std::bad_alloc&)
+        {
+          status = status_memout;
+          out = "out of memory";
+        }
+      catch (const std::exception& e)
+        {
+          status = status_error;
+          out = e.what();
+        }
+      std::cout.flush();
+      std::cerr.flush();
+      write_all(fds[1], status + std::to_string(code) + '\n' + out);
+      close(fds[1]);
+      _exit(0);
+    }
+  close(fds[1]);
+  running_.push_back({pid, fds[0], std::chrono::steady_clock::now(),
+                      std::string(), std::move(done), timeout, false, false});
+  return pid;
+}
+
+void process_pool::wait_all()
+{
+  while (!running_.empty())
+    wait_some();
+}
+
+void process_pool::cancel(pid_t pid)
+{
+  for (child& c: running_)
+    if (c.pid == pid && !c.cancelled)
+      {
+        kill(c.pid, SIGKILL);
+        c.cancelled = true;
+      }
+}
+
+void process_pool::wait_some()
+{
+  if (running_.empty())
+    return;
+  std::vector<pollfd> pfds;
+  int delay = prepare_poll(pfds);
+  int res = poll(pfds.data(), pfds.size(), delay);
+  if (res < 0 && errno != EINTR)
+    throw std::runtime_error(std::string("poll: ") + strerror(errno));
+  if (res <= 0)
+    return;
+  process_poll(pfds, 0);
+}
+
+int process_pool::prepare_poll(std::vector<pollfd>& pfds)
+{
+  auto now = std::chrono::steady_clock::now();
+  int delay = -1;
+  for (child& c: running_)
+    {
+      pfds.push_back({c.fd, POLLIN, 0});
+      if (c.timeout > 0 && !c.timed_out)
+        {
+          std::chrono::duration<double> elapsed = now - c.start;
+          double left = c.timeout - elapsed.count();
+          if (left <= 0)
+            {
+              kill(c.pid, SIGKILL);
+              c.timed_out = true;
+              continue;
+            }
+          int ms = left * 1000 + 1;
+          if (delay < 0 || ms < delay)
+            delay = ms;
+        }
+    }
+  return delay;
+}
+
+void process_pool::process_poll(const std::vector<pollfd>& pfds,
+                                unsigned first)
+{
+  // Iterate backward, so that finished children can be removed.
+  // Their callbacks are only called once running_ is consistent, in
+  // case they want to submit more jobs.
+  std::vector<child> finished;
+  for (unsigned i = running_.size(); i-- > 0;)
+    {
+      if (!pfds[first + i].revents)
+        continue;
+      child& c = running_[i];
+      char buf[4096];
+      ssize_t n = read(c.fd, buf, sizeof buf);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n > 0)
+        {
+          c.buffer.append(buf, n);
+          continue;
+        }
+      finished.push_back(std::move(c));
+      running_.erase(running_.begin() + i);
+    }
+  for (child& c: finished)
+    finish(c);
+}
+
+void process_pool::finish(child& c)
+{
+  close(c.fd);
+  int wstatus;
+  while (waitpid(c.pid, &wstatus, 0) < 0 && errno == EINTR)
+    continue;
+  job_result r;
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - c.start;
+  r.wall = elapsed.count();
+  size_t eol = c.buffer.find('\n');
+  if (c.cancelled)
+    {
+      r.status = job_result::JOB_CANCELLED;
+      r.output = "cancelled";
+    }
+  else if (c.timed_out)
+    {
+      r.status = job_result::JOB_TIMEOUT;
+      r.output = "timeout";
+    }
+  else if (!c.buffer.empty() && eol != std::string::npos)
+    {
+      switch (c.buffer[0])
+        {
+        case status_ok:
+          r.status = job_result::JOB_OK;
+          break;
+        case status_memout:
+          r.status = job_result::JOB_MEMOUT;
+          break;
+        default:
+          r.status = job_result::JOB_ERROR;
+          break;
+        }
+      r.exit_code = atoi(c.buffer.c_str() + 1);
+      r.output = c.buffer.substr(eol + 1);
+    }
+  else if (WIFSIGNALED(wstatus))
+    {
+      r.status = job_result::JOB_ERROR;
+      r.output = std::string("killed by signal ")
+        + strsignal(WTERMSIG(wstatus));
+    }
+  else
+    {
+      r.status = job_result::JOB_ERROR;
+      r.output = "terminated without reporting";
+    }
+  c.done(r);
+}
@@ -0,0 +1,138 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <sys/types.h>
+
+// Write all of S to FD, retrying after partial writes and
+// interruptions.  Return false on error.
+bool write_all(int fd, const std::string& s);
+
+// The outcome of a job run by process_pool.
+struct job_result
+{
+  enum status_t {
+    JOB_OK,                     // the job returned normally
+    JOB_TIMEOUT,                // the job was killed after its deadline
+    JOB_MEMOUT,                 // the job ran out of memory
+    JOB_ERROR,                  // the job threw or was killed by a signal
+    JOB_CANCELLED,              // the job was killed by cancel()
+  };
+  status_t status = JOB_ERROR;
+  // The value returned by the job, when status == JOB_OK.
+  int exit_code = 0;
+  // The output of the job, or an error message.
+  std::string output;
+  // Wall-clock time between the start and the end of the job.
+  double wall = 0.0;
+};
+
+// Run jobs in forked processes, at most JOBS at a time.
+//
+// Spot (and BuDDy in particular) is not thread-safe, so concurrent
+// checks have to run in separate processes.  Forking after the model
+// has been loaded (and the formula translated) also means that the
+// children share those structures with the parent instead of
+// rebuilding them.
+//
+// A job is a function executed in the child.  It returns an exit
+// code, and may fill a string that is sent back to the parent.  Once
+// the job has terminated, its callback is called in the parent with
+// the corresponding job_result.  The child never returns from
+// submit(): it calls _exit() once the job is done.
+class process_pool final
+{
+public:
+  typedef std::function<int(std::string&)> job_t;
+  typedef std::function<void(const job_result&)> callback_t;
+
+  // A TIMEOUT (in seconds) or MAX_MEMORY (in bytes) of 0 means no
+  // limit.  MAX_MEMORY bounds the address space that a job may add
+  // to the one it inherits from the parent when it is forked.
+  process_pool(unsigned jobs, double timeout = 0, size_t max_memory = 0);
+  ~process_pool();
+
+  // Start JOB as soon as a slot is available, and return the process
+  // running it.  This may call the callbacks of previous jobs.
+  pid_t submit(job_t job, callback_t done);
+  // Likewise, with limits specific to this job instead of those of
+  // the pool.
+  pid_t submit(job_t job, callback_t done,
+               double timeout, size_t max_memory);
+
+  // Wait for all submitted jobs to terminate.
+  void wait_all();
+
+  // Kill the job running in process PID, as returned by submit(), if
+  // it is still running.  Its callback is still called, with the
+  // JOB_CANCELLED status, once it has been reaped.
+  void cancel(pid_t pid);
+
+  // Number of jobs currently running.
+  unsigned running() const
+  {
+    return running_.size();
+  }
+
+  // Whether a new job could start without waiting.
+  bool available() const
+  {
+    return running_.size() < jobs_;
+  }
+
+  // Default number of jobs: the number of online processors.
+  static unsigned default_jobs();
+
+  // For event loops that also wait on other file descriptors: append
+  // the descriptors of the running jobs to FDS, and return the delay
+  // before the next deadline in milliseconds (-1 if there is none).
+  // Once poll() has returned, pass the same FDS to process_poll(),
+  // with the index of the first descriptor appended.  No job may be
+  // submitted in between.
+  int prepare_poll(std::vector<pollfd>& fds);
+  void process_poll(const std::vector<pollfd>& fds, unsigned first);
+
+private:
+  struct child
+  {
+    pid_t pid;
+    int fd;
+    std::chrono::steady_clock::time_point start;
+    std::string buffer;
+    callback_t done;
+    double timeout;
+    bool timed_out;
+    bool cancelled;
+  };
+
+  // Wait until at least one job terminates.
+  void wait_some();
+  void finish(child& c);
+
+  unsigned jobs_;
+  double timeout_;
+  size_t max_memory_;
+  std::vector<child> running_;
+};
@@ -0,0 +1,159 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "config.h"
+#include "query.hh"
+
+#include <chrono>
+#include <sstream>
+#include <sys/stat.h>
+#include <spot/tl/parse.hh>
+
+const char* query_result::verdict_name(verdict_t v)
+{
+  switch (v)
+    {
+    case SATISFIED:
+      return "satisfied";
+    case VIOLATED:
+      return "violated";
+    case TIMEOUT:
+      return "timeout";
+    case MEMOUT:
+      return "out of memory";
+    case ERROR:
+      return "error";
+    }
+  return "error";
+}
+
+query_engine::query_engine(unsigned jobs, bool fast_parser)
+  : dict_(spot::make_bdd_dict()), fast_parser_(fast_parser), pool_(jobs)
+{
+}
+
+tc_model& query_engine::model(const std::string& filename, bool& cached)
+{
+  struct stat st;
+  if (stat(filename.c_str(), &st))
+    throw std::runtime_error("cannot open " + filename);
+  auto it = models_.find(filename);
+  cached = (it != models_.end()
+            && it->second.mtime.tv_sec == st.st_mtim.tv_sec
+            && it->second.mtime.tv_nsec == st.st_mtim.tv_nsec
+            && it->second.size == st.st_size);
+  if (cached)
+    return it->second.model;
+  if (it != models_.end())
+    models_.erase(it);
+  tc_model m = tc_model::load(filename, fast_parser_);
+  // The warnings would not be associated to any query.
+  m.get_logs();
+  return models_.emplace(filename, cached_model{m, st.st_mtim, st.st_size})
+    .first->second.model;
+}
+
+spot::twa_graph_ptr
+query_engine::automaton(const spot::formula& f, bool& cached)
+{
+  auto it = automata_.find(f);
+  cached = it != automata_.end();
+  if (cached)
+    return it->second;
+  auto aut = translate_cached(spot::formula::Not(f), dict_);
+  automata_.emplace(f, aut);
+  return aut;
+}
+
+void query_engine::forget_model(const std::string& filename)
+{
+  models_.erase(filename);
+}
+
+void query_engine::submit(const query& q, callback_t done)
+{
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [start] {
+    std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+  };
+  query_result res;
+  tc_model* mp;
+  spot::twa_graph_ptr aut;
+  spot::atomic_prop_set ap;
+  try
+    {
+      spot::parsed_formula pf = spot::parse_infix_psl(q.formula);
+      std::ostringstream err;
+      if (pf.format_errors(err))
+        throw std::runtime_error(err.str());
+      mp = &model(q.model, res.cached_model);
+      aut = automaton(pf.f, res.cached_automaton);
+      spot::atomic_prop_collect(pf.f, &ap);
+    }
+  catch (const std::exception& e)
+    {
+      res.error = e.what();
+      res.time = elapsed();
+      done(res);
+      return;
+    }
+
+  // Keep a copy of the model (i.e., a reference to its shared details),
+  // in case the callback of another job removes it from the cache
+  // before this job is forked.
+  tc_model m = *mp;
+  pool_.submit([this, m, aut, ap, q](std::string& out) mutable {
+      auto k = m.kripke(&ap, dict_, q.dead, q.semantics);
+      auto start = std::chrono::steady_clock::now();
+      tc_check_result r = model_check(k, aut);
+      std::chrono::duration<double> search =
+        std::chrono::steady_clock::now() - start;
+      // The same figures as --compare-semantics: see check_in_child().
+      // They do not include the construction of the counterexample.
+      std::ostringstream os;
+      os << r.stats.states_visited << ' ' << r.stats.transitions_generated
+         << ' ' << search.count();
+      out = os.str();
+      return int(r.verdict == verdict_violated);
+    }, [res, done, elapsed](const job_result& r) mutable {
+      res.time = elapsed();
+      switch (r.status)
+        {
+        case job_result::JOB_OK:
+          res.verdict =
+            r.exit_code ? query_result::VIOLATED : query_result::SATISFIED;
+          std::istringstream(r.output)
+            >> res.states >> res.transitions >> res.search_time;
+          break;
+        case job_result::JOB_TIMEOUT:
+          res.verdict = query_result::TIMEOUT;
+          break;
+        case job_result::JOB_MEMOUT:
+          res.verdict = query_result::MEMOUT;
+          break;
+        case job_result::JOB_CANCELLED:
+        case job_result::JOB_ERROR:
+          res.verdict = query_result::ERROR;
+          res.error = r.output;
+          break;
+        }
+      done(res);
+    }, q.timeout, q.max_memory);
+}
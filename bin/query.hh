@@ -0,0 +1,124 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <ctime>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <spot/twa/twagraph.hh>
+#include "pool.hh"
+#include "tcltl.hh"
+
+// One model-checking query, as received by --serve.
+struct query
+{
+  // The filename of the model.
+  std::string model;
+  // The LTL formula to check (Spot's syntax).
+  std::string formula;
+  zg_zone_semantics semantics = elapsed_extraLUplus_local;
+  spot::formula dead = spot::formula::tt();
+  // Limits of the check, in seconds and bytes.  0 means no limit.
+  double timeout = 0;
+  size_t max_memory = 0;
+};
+
+struct query_result
+{
+  enum verdict_t { SATISFIED, VIOLATED, TIMEOUT, MEMOUT, ERROR };
+  verdict_t verdict = ERROR;
+  // The error message, when verdict == ERROR.
+  std::string error;
+  // States whose successors were computed, and transitions followed,
+  // during the search (states_visited and transitions_generated).
+  unsigned long states = 0;
+  unsigned long transitions = 0;
+  // Wall-clock time of the whole query, and of the emptiness check.
+  double time = 0.0;
+  double search_time = 0.0;
+  // Whether the model and the automaton were found in the caches.
+  bool cached_model = false;
+  bool cached_automaton = false;
+
+  static const char* verdict_name(verdict_t v);
+};
+
+// Run queries on a process_pool, keeping the models loaded and the
+// formulas translated in caches shared by all the queries.
+//
+// Loading and translation happen in this process, so that the forked
+// workers inherit them; only the emptiness checks run in parallel.
+// A model is reloaded whenever its file has been modified.
+class query_engine final
+{
+public:
+  typedef std::function<void(const query_result&)> callback_t;
+
+  // FAST_PARSER is passed to tc_model::load().
+  query_engine(unsigned jobs, bool fast_parser = false);
+
+  // Start Q as soon as a worker is available, and call DONE with its
+  // result.  DONE is called immediately if the model cannot be loaded
+  // or the formula cannot be translated.
+  void submit(const query& q, callback_t done);
+
+  // Drop FILENAME from the cache of models.
+  void forget_model(const std::string& filename);
+
+  unsigned models_cached() const
+  {
+    return models_.size();
+  }
+
+  unsigned automata_cached() const
+  {
+    return automata_.size();
+  }
+
+  process_pool& pool()
+  {
+    return pool_;
+  }
+
+private:
+  // A model is reloaded when its file changes.  One-second
+  // timestamps would miss a change made in the same second as the
+  // loading, hence the nanoseconds and the size.
+  struct cached_model
+  {
+    tc_model model;
+    timespec mtime;
+    off_t size;
+  };
+  // Return the model loaded from FILENAME, and set CACHED if it was
+  // found in the cache.
+  tc_model& model(const std::string& filename, bool& cached);
+  // Return the automaton of the negation of FORMULA.
+  spot::twa_graph_ptr automaton(const spot::formula& formula, bool& cached);
+
+  spot::bdd_dict_ptr dict_;
+  bool fast_parser_;
+  std::map<std::string, cached_model> models_;
+  std::map<spot::formula, spot::twa_graph_ptr> automata_;
+  process_pool pool_;
+};
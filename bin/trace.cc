@@ -0,0 +1,126 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "config.h"
+#include "trace.hh"
+#include "json.hh"
+#include "pool.hh"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Timestamps are in microseconds.  The steady clock is shared with
+// forked children, so their events line up with those of the parent.
+static long long now_us()
+{
+  auto d = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+trace_writer::trace_writer(const std::string& filename)
+  : pid_(getpid())
+{
+  fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+  if (fd_ < 0)
+    throw std::runtime_error("cannot open " + filename + ": "
+                             + strerror(errno));
+  // Every other event is written with a leading comma, so that the
+  // array is valid JSON whatever the order in which children flush.
+  std::ostringstream os;
+  os << "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid_
+     << ",\"tid\":0,\"args\":{\"name\":\"tcltl\"}}";
+  buffer_ = os.str();
+  set_track(0, "main");
+}
+
+trace_writer::~trace_writer()
+{
+  buffer_ += "\n]\n";
+  flush();
+  close(fd_);
+}
+
+unsigned trace_writer::track() const
+{
+  auto i = tracks_.find(std::this_thread::get_id());
+  return i == tracks_.end() ? 0 : i->second;
+}
+
+void trace_writer::event(char phase, const char* name)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ostringstream os;
+  os << ",\n{\"name\":" << json_quote(name) << ",\"ph\":\"" << phase
+     << "\",\"ts\":" << now_us() << ",\"pid\":" << pid_
+     << ",\"tid\":" << track() << '}';
+  buffer_ += os.str();
+}
+
+void trace_writer::begin(const char* name)
+{
+  event('B', name);
+}
+
+void trace_writer::end(const char* name)
+{
+  event('E', name);
+}
+
+void trace_writer::counter(const char* name,
+                           const std::vector<std::pair<const char*,
+                                                       double>>& values)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ostringstream os;
+  os << ",\n{\"name\":" << json_quote(name) << ",\"ph\":\"C\",\"ts\":"
+     << now_us() << ",\"pid\":" << pid_ << ",\"tid\":" << track()
+     << ",\"args\":{";
+  os.precision(15);
+  const char* sep = "";
+  for (auto& [key, val]: values)
+    {
+      os << sep << json_quote(key) << ':' << val;
+      sep = ",";
+    }
+  os << "}}";
+  buffer_ += os.str();
+}
+
+void trace_writer::set_track(unsigned tid, const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  tracks_[std::this_thread::get_id()] = tid;
+  std::ostringstream os;
+  os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid_
+     << ",\"tid\":" << tid << ",\"args\":{\"name\":" << json_quote(name)
+     << "}}";
+  buffer_ += os.str();
+}
+
+void trace_writer::flush()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  write_all(fd_, buffer_);
+  buffer_.clear();
+}
@@ -0,0 +1,70 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "tcltl.hh"
+
+// Write a timeline in the Trace Event Format of Chrome, which can be
+// loaded in chrome://tracing or https://ui.perfetto.dev/.
+//
+// Events are buffered, and appended to the file by flush() with a
+// single write().  The file is opened in append mode, so that the
+// children forked by process_pool may share it: each child calls
+// set_track() to get its own track, and flush() once its job is done.
+// Threads may share a trace_writer too, each on its own track.
+class trace_writer final: public tc_trace
+{
+public:
+  // Create FILENAME.  This throws std::runtime_error on failure.
+  trace_writer(const std::string& filename);
+  // Flush the remaining events, and terminate the JSON array.
+  ~trace_writer();
+
+  void begin(const char* name) override;
+  void end(const char* name) override;
+
+  // Record the values of some counters, displayed as a graph.
+  void counter(const char* name,
+               const std::vector<std::pair<const char*, double>>& values);
+
+  // Attribute the next events of the calling thread to track TID,
+  // called NAME.  Threads that never call this use track 0.
+  void set_track(unsigned tid, const std::string& name);
+
+  // Append the buffered events to the file.
+  void flush();
+
+private:
+  void event(char phase, const char* name);
+  // The track of the calling thread.  mutex_ must be held.
+  unsigned track() const;
+
+  int fd_;
+  int pid_;
+  std::mutex mutex_;
+  std::map<std::thread::id, unsigned> tracks_;
+  std::string buffer_;
+};
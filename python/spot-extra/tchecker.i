@@ -17,7 +17,7 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-%module(package="spot", director="1") tchecker
+%module(package="spot", directors="1") tchecker
 
 %include "std_string.i"
 %include "exception.i"
@@ -26,25 +26,52 @@
 
 %shared_ptr(spot::bdd_dict)
 %shared_ptr(spot::twa)
+%shared_ptr(spot::twa_graph)
 %shared_ptr(spot::kripke)
 %shared_ptr(spot::fair_kripke)
+%shared_ptr(spot::twa_run)
 
 %{
 #include <tcltl.hh>
+
+// Release the GIL for the lifetime of this object.
+class gil_release
+{
+public:
+  gil_release()
+    : state_(PyEval_SaveThread())
+  {
+  }
+
+  ~gil_release()
+  {
+    PyEval_RestoreThread(state_);
+  }
+private:
+  PyThreadState* state_;
+};
 %}
 
 %import(module="spot.impl") <spot/misc/common.hh>
 %import(module="spot.impl") <spot/twa/bdddict.hh>
 %import(module="spot.impl") <spot/twa/twa.hh>
+%import(module="spot.impl") <spot/twa/twagraph.hh>
 %import(module="spot.impl") <spot/tl/formula.hh>
 %import(module="spot.impl") <spot/tl/apcollect.hh>
 %import(module="spot.impl") <spot/kripke/fairkripke.hh>
 %import(module="spot.impl") <spot/kripke/kripke.hh>
+%import(module="spot.impl") <spot/twaalgos/emptiness.hh>
+
+%feature("director") tc_progress;
 
 %exception {
   try {
     $action
   }
+  catch (Swig::DirectorException&)
+  {
+    SWIG_fail;
+  }
   catch (const spot::parse_error& e)
   {
     std::string er("\n");
@@ -55,37 +82,132 @@
   {
     SWIG_exception(SWIG_RuntimeError, e.what());
   }
+  catch (const std::bad_alloc&)
+  {
+    SWIG_exception(SWIG_MemoryError, "out of memory");
+  }
+  catch (const std::exception& e)
+  {
+    SWIG_exception(SWIG_RuntimeError, e.what());
+  }
+  catch (...)
+  {
+    SWIG_exception(SWIG_UnknownError, "unknown C++ exception");
+  }
 }
 
+// Loading a model only involves TChecker, so other Python threads,
+// including those loading other models, may run meanwhile.
+// Everything else (kripke(), model_check(), and the exploration of
+// the Kripke structures) uses BuDDy.  BuDDy is not thread-safe, and
+// the functions of Spot's own module use it while holding the GIL, so
+// the GIL is the lock that protects it: it must not be released there.
+//
+// Every exception is converted into a Python exception, after the GIL
+// has been taken back by the destruction of NOGIL.
+%define %tcltl_release_gil(FUNCTION)
+%exception FUNCTION {
+  try {
+    gil_release nogil;
+    $action
+  }
+  catch (const std::runtime_error& e)
+  {
+    SWIG_exception(SWIG_RuntimeError, e.what());
+  }
+  catch (const std::bad_alloc&)
+  {
+    SWIG_exception(SWIG_MemoryError, "out of memory");
+  }
+  catch (const std::exception& e)
+  {
+    SWIG_exception(SWIG_RuntimeError, e.what());
+  }
+  catch (...)
+  {
+    SWIG_exception(SWIG_UnknownError, "unknown C++ exception");
+  }
+}
+%enddef
+%tcltl_release_gil(tc_model::load);
+%tcltl_release_gil(tc_model::load_from_string);
+// The result of a tc_async_check is computed by another process.
+%tcltl_release_gil(tc_async_check::result);
+%tcltl_release_gil(tc_async_check::counterexample);
+
 %rename(model) tc_model;
 %rename(kripke_raw) tc_model::kripke;
+%rename(kripke_statistics) tc_kripke_stats;
+%rename(progress) tc_progress;
+%rename(budget) tc_budget;
+%rename(async_check_raw) tc_async_check;
+%rename(check_result) tc_check_result;
+%ignore tc_state_space::locations;
+%ignore tc_state_space::valuations;
+%ignore tc_state_space::dbms;
+%ignore tc_state_space::edge_offsets;
+%ignore tc_state_space::edge_targets;
+%ignore tc_state_space::ap_names;
+%ignore tc_state_space::labels;
+%ignore tc_budget_exceeded;
+%ignore tc_trace_scope;
+%ignore tc_model::load_from_stream;
 %include <tcltl.hh>
 
+// The arrays of tc_state_space are exported by state_space() below,
+// from their addresses.
+%extend tc_state_space {
+  PyObject* _buffers()
+  {
+    PyObject* res = PyDict_New();
+    auto add = [res](const char* name, const auto& v)
+      {
+        PyObject* t = Py_BuildValue("(Kn)",
+                                    (unsigned long long) v.data(),
+                                    (Py_ssize_t) (v.size()
+                                                  * sizeof(v[0])));
+        PyDict_SetItemString(res, name, t);
+        Py_DECREF(t);
+      };
+    add("locations", $self->locations);
+    add("valuations", $self->valuations);
+    add("dbms", $self->dbms);
+    add("edge_offsets", $self->edge_offsets);
+    add("edge_targets", $self->edge_targets);
+    add("labels", $self->labels);
+    return res;
+  }
+
+  PyObject* _ap_names()
+  {
+    PyObject* res = PyList_New($self->ap_names.size());
+    for (size_t i = 0; i < $self->ap_names.size(); ++i)
+      PyList_SET_ITEM(res, i,
+                      PyUnicode_FromString($self->ap_names[i].c_str()));
+    return res;
+  }
+}
+
 %pythoncode %{
 import spot
-import spot.aux
 import sys
 import subprocess
-import tempfile
 
-def load(filename):
+def load(filename, fast_parser=False):
   """Load a TChecker model.
 
 The argument is assumed to be a filename if it contains no newline.
 Otherwise it is assumed to be the actual text of the model.
+
+If fast_parser is True, first try a faster parser for large generated
+models, falling back to TChecker's parser on errors.
 """
-  if '\n' in filename:
-    # Assume it's an actual model.
-    with spot.aux.tmpdir():
-       with tempfile.NamedTemporaryFile(dir='.', suffix='.tc') as t:
-           # See ticktac-project/tchecker#35
-           if filename[-1] != '\n':
-               filename += '\n'
-           t.write(filename.encode('utf-8'))
-           t.flush()
-           return load(t.name)
   try:
-    m = model.load(filename)
+    if '\n' in filename:
+      # Assume it's an actual model.
+      m = model.load_from_string(filename, fast_parser)
+    else:
+      m = model.load(filename, fast_parser)
     logs = m.get_logs()
     if logs:
       print(logs, end='', file=sys.stderr)
@@ -94,15 +216,281 @@ Otherwise it is assumed to be the actual text of the model.
     m = None
   return m
 
+class _progress_function(progress):
+  def __init__(self, fn):
+    super().__init__()
+    self._fn = fn
+
+  def report(self, stats, elapsed):
+    self._fn(stats, elapsed)
+
+def set_progress(kripke, fn, period=1.0):
+  """Call fn(stats, elapsed) about every period seconds while kripke
+is being explored.
+
+The stats argument gives the current kripke_statistics, and elapsed
+is the number of seconds since set_progress() was called.  Passing
+None as fn disables progress reporting.
+"""
+  if fn is None:
+    set_kripke_progress(kripke, None, period)
+    kripke._tcltl_progress = None
+    return
+  handler = _progress_function(fn)
+  set_kripke_progress(kripke, handler, period)
+  # The C++ side does not own the handler, so keep it alive as long
+  # as the Kripke structure.
+  kripke._tcltl_progress = handler
+
+def translate(formula, dict=spot._bdd_dict):
+  """Translate formula into an automaton, like spot.translate() with its
+default options, but reusing the automata cached on disk by tcltl.
+
+The cache is stored in $TCLTL_CACHE_DIR, or ~/.cache/tcltl.
+"""
+  return translate_cached(spot.formula(formula), dict)
+
+def set_budget(kripke, b):
+  """Have kripke stop its exploration when a limit of the budget b is
+exceeded.  Passing None removes the limits.
+
+The exploration stops by giving no more successors, so that Spot's
+algorithms terminate normally.  check() reports this as
+verdict_unknown; after other algorithms (e.g., kripke.intersects()),
+check_kripke_budget(kripke) raises RuntimeError if their result is
+incomplete.
+"""
+  set_kripke_budget(kripke, b)
+  # The C++ side does not own the budget.
+  kripke._tcltl_budget = b
+
+def check(kripke, formula, budget=None):
+  """Check whether kripke satisfies formula.
+
+The result has a verdict (verdict_satisfied, verdict_violated, or
+verdict_unknown if a limit of the budget was hit, in which case reason
+says which), a counterexample run when the formula is violated, and
+the kripke_statistics of the exploration.
+"""
+  f = spot.formula.Not(spot.formula(formula))
+  aut = translate_cached(f, kripke.get_dict())
+  return model_check(kripke, aut, budget)
+
+class async_check:
+  """A check running in the background, as started by check_async().
+
+It may be awaited from asyncio, which returns the same as result().
+"""
+  def __init__(self, raw):
+    self._raw = raw
+
+  def done(self):
+    """Whether the result is known."""
+    return self._raw.update()
+
+  def cancel(self):
+    """Ask the check to stop.  Its verdict will then be verdict_unknown,
+unless it was already decided."""
+    self._raw.cancel()
+
+  def progress(self):
+    """Return the last progress report, as a dictionary with the number
+of states generated, the rate in states per second, the memory used by
+the check in bytes, the elapsed time in seconds, and the complete
+kripke_statistics."""
+    self._raw.update()
+    p = self._raw.progress()
+    stats = p.stats
+    # stats points inside p.
+    stats._tcltl_owner = p
+    return {'states': stats.states_generated, 'rate': p.rate,
+            'memory': p.rss, 'elapsed': p.elapsed, 'stats': stats}
+
+  def result(self):
+    """Wait for the check, and return its check_result.  The run of
+the result is None: see counterexample()."""
+    return self._raw.result()
+
+  def counterexample(self):
+    """Wait for the check, and return the counterexample as text, or
+an empty string if there is none."""
+    return self._raw.counterexample()
+
+  def __await__(self):
+    return self._wait().__await__()
+
+  async def _wait(self):
+    import asyncio
+    if not self._raw.update():
+      loop = asyncio.get_running_loop()
+      fut = loop.create_future()
+      def readable():
+        if self._raw.update() and not fut.done():
+          fut.set_result(None)
+      fd = self._raw.fd()
+      loop.add_reader(fd, readable)
+      try:
+        await fut
+      except asyncio.CancelledError:
+        self.cancel()
+        raise
+      finally:
+        loop.remove_reader(fd)
+    return self._raw.result()
+
+def check_async(kripke, formula, budget=None, progress_period=0.2):
+  """Start checking whether kripke satisfies formula in the background,
+and return an async_check to follow it.
+
+The check runs in a forked process, because the BDD library used by
+Spot is not thread-safe.  The limits of budget apply to the check, but
+cancelling the budget afterwards has no effect: use cancel() on the
+result instead.
+"""
+  f = spot.formula.Not(spot.formula(formula))
+  aut = translate_cached(f, kripke.get_dict())
+  return async_check(async_check_raw(kripke, aut, budget, progress_period))
+
+def state_space(kripke, budget=None):
+  """Explore all the states of kripke, and return them as NumPy arrays.
+
+The result has the following attributes, where n is the number of
+states, numbered from 0 (the initial state) in breadth-first order:
+
+- locations: (n, processes) int32, the location of each process
+- valuations: (n, intvars) int32, the integer variables
+- dbms: (n, dim, dim) int32, the zones, in TChecker's encoding
+- edge_offsets: (n + 1,) uint64, and edge_targets: uint32, the
+  successors in compressed sparse rows: those of state i are
+  edge_targets[edge_offsets[i]:edge_offsets[i + 1]]
+- ap_names: the observed atomic propositions
+- labels: (n, bytes) uint8, the bitsets of the propositions that hold
+  in each state; np.unpackbits(labels, axis=1, bitorder='little')
+  gives one column per proposition
+
+The arrays are views of the memory filled by the C++ exploration: no
+element is copied or converted to a Python object.
+"""
+  import ctypes
+  import numpy as np
+  from types import SimpleNamespace
+  ss = explore_state_space(kripke, budget)
+  buffers = ss._buffers()
+  def array(name, dtype, shape):
+    address, size = buffers[name]
+    if size == 0:
+      return np.zeros(shape, dtype)
+    buf = (ctypes.c_char * size).from_address(address)
+    # The array keeps buf alive, which keeps ss alive.
+    buf._tcltl_owner = ss
+    return np.frombuffer(buf, dtype).reshape(shape)
+  n = ss.states
+  m = buffers['edge_targets'][1] // 4
+  return SimpleNamespace(
+    locations=array('locations', np.int32, (n, ss.processes)),
+    valuations=array('valuations', np.int32, (n, ss.intvars)),
+    dbms=array('dbms', np.int32, (n, ss.dbm_dim, ss.dbm_dim)),
+    edge_offsets=array('edge_offsets', np.uint64, (n + 1,)),
+    edge_targets=array('edge_targets', np.uint32, (m,)),
+    ap_names=ss._ap_names(),
+    labels=array('labels', np.uint8, (n, ss.label_bytes)))
+
+def _load_source(text):
+  # Unpickle a model.  Its text was printed by a program, so it is
+  # worth trying the fast parser.
+  return model.load_from_string(text, True)
+
 @spot._extend(model)
 class model:
   def kripke(self, ap_set, dict=spot._bdd_dict,
              dead=spot.formula_ap('dead'),
-             zone_sem=elapsed_extraLUplus_local):
+             zone_sem=elapsed_extraLUplus_local,
+             progress=None, progress_period=1.0, budget=None):
     s = spot.atomic_prop_set()
     for ap in ap_set:
       s.insert(spot.formula_ap(ap))
-    return self.kripke_raw(s, dict, dead, zone_sem)
+    k = self.kripke_raw(s, dict, dead, zone_sem)
+    if progress is not None:
+      set_progress(k, progress, progress_period)
+    if budget is not None:
+      set_budget(k, budget)
+    return k
+
+  def check_many(self, formulas, jobs=0, zone_sem=elapsed_extraLUplus_local,
+                 dict=spot._bdd_dict, dead=spot.formula_ap('dead'),
+                 budget=None):
+    """Check each of formulas against the model, and return one row
+per formula, in the same order.
+
+The formulas share one Kripke structure, labeled by the union of their
+atomic propositions.  Each check runs in a process forked from it, as
+with check_async(), and at most jobs checks run at once (0 means one
+per processor).  The limits of budget apply to each check separately:
+its states and its time count from the start of that check, not of
+the call.
+
+Only the model and the Kripke structure are shared: the zone graph is
+explored on the fly by each check, so a check stops as soon as it
+finds a counterexample, but the checks do not reuse each other's
+states.  To explore it once and analyze it in Python, see
+state_space().
+
+Each row is a dictionary with the formula, its verdict, the limit and
+reason of an unknown verdict, the counterexample as text (empty unless
+the verdict is verdict_violated), and the kripke_statistics of its
+check.
+"""
+    import os
+    import selectors
+    fs = [spot.formula(f) for f in formulas]
+    aps = spot.atomic_prop_set()
+    for f in fs:
+      for ap in spot.atomic_prop_collect(f):
+        aps.insert(ap)
+    k = self.kripke(aps, dict, dead, zone_sem)
+    jobs = jobs or os.cpu_count() or 1
+    rows = [None] * len(fs)
+    todo = list(enumerate(fs))
+    todo.reverse()
+    running = {}
+    sel = selectors.DefaultSelector()
+    try:
+      while todo or running:
+        while todo and len(running) < jobs:
+          i, f = todo.pop()
+          h = check_async(k, str(f), budget)
+          running[h] = i
+          sel.register(h._raw.fd(), selectors.EVENT_READ, h)
+        for key, _ in sel.select():
+          h = key.data
+          if not h.done():
+            continue
+          sel.unregister(key.fd)
+          i = running.pop(h)
+          r = h.result()
+          stats = r.stats
+          stats._tcltl_owner = r
+          rows[i] = {'formula': fs[i], 'verdict': r.verdict,
+                     'limit': r.limit, 'reason': r.reason,
+                     'counterexample': h.counterexample(),
+                     'stats': stats}
+    finally:
+      sel.close()
+      for h in running:
+        h.cancel()
+    return rows
+
+  def __reduce__(self):
+    """Pickle the model as its text, so that it can be sent to the
+workers of multiprocessing.  They load it again, trying the fast
+parser first.  A model loaded from a file is pickled with the current
+text of that file, which must not have been removed or modified since.
+
+On systems where multiprocessing forks its workers, a model that
+exists before the pool is created is inherited by the workers without
+any copy: pickling it is only needed to send it later.
+"""
+    return (_load_source, (self.source(),))
 
   def __repr__(self):
     res = "tchecker model\n";
@@ -0,0 +1,449 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "config.h"
+#include "fastparse.hh"
+
+#if HAVE_TCHECKER_DECLARATIONS
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace tchecker::parsing;
+
+// A token of the input: its text, and its first and last columns
+// (counted from 1, as in TChecker's diagnostics).
+struct fast_token
+{
+  std::string_view text;
+  unsigned first;
+  unsigned last;
+};
+
+// One declaration, i.e., one non-empty line, split on colons.  The
+// attributes between braces are stored separately, as key/value
+// pairs.
+struct fast_line
+{
+  unsigned line;                // relative to the chunk at first
+  unsigned length;              // in columns, without the newline
+  std::vector<fast_token> fields;
+  std::vector<std::pair<fast_token, fast_token>> attributes;
+  bool has_braces = false;
+};
+
+// Return the token of [B, E) within the line starting at LINE_START,
+// without its surrounding blanks.
+static fast_token
+make_token(const char* line_start, const char* b, const char* e)
+{
+  while (b < e && (*b == ' ' || *b == '\t'))
+    ++b;
+  while (e > b && (e[-1] == ' ' || e[-1] == '\t'))
+    --e;
+  unsigned first = b - line_start + 1;
+  return { std::string_view(b, e - b), first,
+           unsigned(first + (e - b) - (e > b)) };
+}
+
+// Tokenize the lines of [B, E), which starts at a beginning of line.
+// Return false on anything unexpected.
+static bool
+tokenize_chunk(const char* b, const char* e, std::vector<fast_line>& out)
+{
+  unsigned line = 0;
+  while (b < e)
+    {
+      const char* eol = static_cast<const char*>(memchr(b, '\n', e - b));
+      if (!eol)
+        eol = e;
+      const char* end = eol;
+      if (const char* hash =
+          static_cast<const char*>(memchr(b, '#', end - b)))
+        end = hash;
+      const char* start = b;
+      while (start < end && (*start == ' ' || *start == '\t'
+                             || *start == '\r'))
+        ++start;
+      if (start < end)
+        {
+          const char* last = end;
+          while (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')
+            --last;
+          fast_line fl;
+          fl.line = line;
+          fl.length = last - b;
+          const char* brace =
+            static_cast<const char*>(memchr(b, '{', end - b));
+          const char* fields_end = brace ? brace : end;
+          const char* p = b;
+          for (;;)
+            {
+              const char* colon = static_cast<const char*>
+                (memchr(p, ':', fields_end - p));
+              const char* fe = colon ? colon : fields_end;
+              fl.fields.push_back(make_token(b, p, fe));
+              if (!colon)
+                break;
+              p = colon + 1;
+            }
+          if (brace)
+            {
+              fl.has_braces = true;
+              const char* close = static_cast<const char*>
+                (memchr(brace, '}', end - brace));
+              if (!close)
+                return false;
+              // Only blanks may follow the closing brace.
+              for (const char* q = close + 1; q < end; ++q)
+                if (*q != ' ' && *q != '\t' && *q != '\r')
+                  return false;
+              // key:value:key:value...
+              p = brace + 1;
+              std::vector<fast_token> parts;
+              for (;;)
+                {
+                  const char* colon = static_cast<const char*>
+                    (memchr(p, ':', close - p));
+                  const char* pe = colon ? colon : close;
+                  parts.push_back(make_token(b, p, pe));
+                  if (!colon)
+                    break;
+                  p = colon + 1;
+                }
+              if (parts.size() == 1 && parts[0].text.empty())
+                parts.clear();
+              if (parts.size() % 2)
+                return false;
+              for (size_t i = 0; i < parts.size(); i += 2)
+                {
+                  if (parts[i].text.empty())
+                    return false;
+                  fl.attributes.emplace_back(parts[i], parts[i + 1]);
+                }
+            }
+          out.push_back(std::move(fl));
+        }
+      b = eol + 1;
+      ++line;
+    }
+  return true;
+}
+
+static bool is_identifier(std::string_view s)
+{
+  if (s.empty() || !(isalpha((unsigned char) s[0]) || s[0] == '_'))
+    return false;
+  for (char c: s)
+    if (!(isalnum((unsigned char) c) || c == '_' || c == '.'))
+      return false;
+  return true;
+}
+
+static bool to_integer(std::string_view s, long& res)
+{
+  std::string tmp(s);
+  if (tmp.empty())
+    return false;
+  char* end;
+  errno = 0;
+  res = strtol(tmp.c_str(), &end, 10);
+  return !*end && !errno;
+}
+
+// Format a position as TChecker does: "LINE.FIRST-LAST", or
+// "LINE.FIRST" for a single column.
+static std::string context(unsigned line, unsigned first, unsigned last)
+{
+  std::string res = std::to_string(line) + '.' + std::to_string(first);
+  if (last > first)
+    res += '-' + std::to_string(last);
+  return res;
+}
+
+// Build the declarations of LINES.  Return nullptr on error.
+static system_declaration_t*
+build_declarations(std::vector<fast_line>& lines)
+{
+  if (lines.empty())
+    return nullptr;
+  auto ctx = [](const fast_line& l) {
+    return context(l.line, 1, l.length);
+  };
+  auto tok_ctx = [](const fast_line& l, const fast_token& t) {
+    return context(l.line, t.first, t.last);
+  };
+
+  const fast_line& first = lines.front();
+  if (first.fields.size() != 2 || first.fields[0].text != "system"
+      || !is_identifier(first.fields[1].text) || first.has_braces)
+    return nullptr;
+  auto sysdecl = std::make_unique<system_declaration_t>
+    (std::string(first.fields[1].text), ctx(first));
+
+  // Clocks and integer variables share the same namespace, so that a
+  // name is reused in either way, TChecker gives the diagnostic.
+  std::unordered_map<std::string_view, bool> variables;
+
+  for (size_t i = 1; i < lines.size(); ++i)
+    {
+      const fast_line& l = lines[i];
+      const std::vector<fast_token>& f = l.fields;
+      std::string_view kind = f[0].text;
+      auto name = [&](unsigned n) { return std::string(f[n].text); };
+      for (auto& t: f)
+        if (&t != &f[0] && !is_identifier(t.text)
+            && !(kind == "int" || kind == "clock" || kind == "sync"))
+          return nullptr;
+      if (l.has_braces && kind != "location" && kind != "edge")
+        return nullptr;
+
+      if (kind == "clock")
+        {
+          long size;
+          if (f.size() != 3 || !to_integer(f[1].text, size) || size < 1
+              || !is_identifier(f[2].text)
+              || !variables.emplace(f[2].text, true).second)
+            return nullptr;
+          auto d = std::make_unique<clock_declaration_t>(name(2), size,
+                                                         ctx(l));
+          if (!sysdecl->insert_clock_declaration(d.get()))
+            return nullptr;
+          d.release();
+        }
+      else if (kind == "int")
+        {
+          long size, min, max, init;
+          if (f.size() != 6 || !to_integer(f[1].text, size) || size < 1
+              || !to_integer(f[2].text, min) || !to_integer(f[3].text, max)
+              || !to_integer(f[4].text, init)
+              || min > max || init < min || init > max
+              || !is_identifier(f[5].text)
+              || !variables.emplace(f[5].text, true).second)
+            return nullptr;
+          auto d = std::make_unique<int_declaration_t>(name(5), size, min,
+                                                       max, init, ctx(l));
+          if (!sysdecl->insert_int_declaration(d.get()))
+            return nullptr;
+          d.release();
+        }
+      else if (kind == "event")
+        {
+          if (f.size() != 2 || sysdecl->get_event_declaration(name(1)))
+            return nullptr;
+          auto d = std::make_unique<event_declaration_t>(name(1), ctx(l));
+          if (!sysdecl->insert_event_declaration(d.get()))
+            return nullptr;
+          d.release();
+        }
+      else if (kind == "process")
+        {
+          if (f.size() != 2 || sysdecl->get_process_declaration(name(1)))
+            return nullptr;
+          auto d = std::make_unique<process_declaration_t>(name(1), ctx(l));
+          if (!sysdecl->insert_process_declaration(d.get()))
+            return nullptr;
+          d.release();
+        }
+      else if (kind == "location" || kind == "edge")
+        {
+          bool loc = kind == "location";
+          if (f.size() != (loc ? 3u : 5u))
+            return nullptr;
+          auto* proc = sysdecl->get_process_declaration(name(1));
+          if (!proc)
+            return nullptr;
+          attributes_t attr;
+          for (auto& [key, val]: l.attributes)
+            attr.insert(new attr_t(std::string(key.text),
+                                   std::string(val.text),
+                                   tok_ctx(l, key), tok_ctx(l, val)));
+          if (loc)
+            {
+              if (sysdecl->get_location_declaration(name(1), name(2)))
+                return nullptr;
+              auto d = std::make_unique<location_declaration_t>
+                (name(2), *proc, std::move(attr), ctx(l));
+              if (!sysdecl->insert_location_declaration(d.get()))
+                return nullptr;
+              d.release();
+            }
+          else
+            {
+              auto* src = sysdecl->get_location_declaration(name(1), name(2));
+              auto* tgt = sysdecl->get_location_declaration(name(1), name(3));
+              auto* evt = sysdecl->get_event_declaration(name(4));
+              if (!src || !tgt || !evt)
+                return nullptr;
+              auto d = std::make_unique<edge_declaration_t>
+                (*proc, *src, *tgt, *evt, std::move(attr), ctx(l));
+              if (!sysdecl->insert_edge_declaration(d.get()))
+                return nullptr;
+              d.release();
+            }
+        }
+      else if (kind == "sync")
+        {
+          if (f.size() < 2)
+            return nullptr;
+          std::vector<const sync_constraint_t*> constraints;
+          auto cleanup = [&] {
+            for (auto* c: constraints)
+              delete c;
+          };
+          for (size_t n = 1; n < f.size(); ++n)
+            {
+              std::string_view t = f[n].text;
+              tchecker::sync_strength_t strength = tchecker::SYNC_STRONG;
+              if (!t.empty() && t.back() == '?')
+                {
+                  strength = tchecker::SYNC_WEAK;
+                  t.remove_suffix(1);
+                }
+              size_t at = t.find('@');
+              const process_declaration_t* proc = nullptr;
+              const event_declaration_t* evt = nullptr;
+              if (at != std::string_view::npos)
+                {
+                  proc = sysdecl->get_process_declaration
+                    (std::string(t.substr(0, at)));
+                  evt = sysdecl->get_event_declaration
+                    (std::string(t.substr(at + 1)));
+                }
+              if (!proc || !evt)
+                {
+                  cleanup();
+                  return nullptr;
+                }
+              constraints.push_back
+                (new sync_constraint_t(*proc, *evt, strength));
+            }
+          auto d = std::make_unique<sync_declaration_t>
+            (std::move(constraints), ctx(l));
+          if (!sysdecl->insert_sync_declaration(d.get()))
+            return nullptr;
+          d.release();
+        }
+      else
+        {
+          return nullptr;
+        }
+    }
+  return sysdecl.release();
+}
+
+// Files smaller than this are tokenized by a single thread.
+static const size_t fast_parse_chunk = 1 << 20;
+
+system_declaration_t*
+fast_parse_system_declaration(const std::string& filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) || st.st_size == 0)
+    {
+      close(fd);
+      return nullptr;
+    }
+  size_t size = st.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return nullptr;
+  const char* data = static_cast<const char*>(map);
+  // TChecker requires the last line to end with a newline.
+  if (data[size - 1] != '\n')
+    {
+      munmap(map, size);
+      return nullptr;
+    }
+
+  // Split the file into chunks at line boundaries, and tokenize them
+  // in parallel.
+  unsigned nthreads = std::max(1u, std::thread::hardware_concurrency());
+  nthreads = std::min<size_t>(nthreads, size / fast_parse_chunk + 1);
+  std::vector<const char*> bounds = { data };
+  for (unsigned t = 1; t < nthreads; ++t)
+    {
+      const char* p = data + size * t / nthreads;
+      if (p < bounds.back())
+        p = bounds.back();
+      const char* eol =
+        static_cast<const char*>(memchr(p, '\n', data + size - p));
+      bounds.push_back(eol ? eol + 1 : data + size);
+    }
+  bounds.push_back(data + size);
+  unsigned nchunks = bounds.size() - 1;
+  std::vector<std::vector<fast_line>> chunks(nchunks);
+  std::vector<char> ok(nchunks, false);
+  std::vector<unsigned> newlines(nchunks, 0);
+  auto work = [&](unsigned c) {
+    ok[c] = tokenize_chunk(bounds[c], bounds[c + 1], chunks[c]);
+    newlines[c] = std::count(bounds[c], bounds[c + 1], '\n');
+  };
+  std::vector<std::thread> threads;
+  for (unsigned c = 1; c < nchunks; ++c)
+    threads.emplace_back(work, c);
+  work(0);
+  for (auto& t: threads)
+    t.join();
+
+  std::vector<fast_line> lines;
+  unsigned first_line = 1;
+  bool all_ok = true;
+  for (unsigned c = 0; c < nchunks; ++c)
+    {
+      all_ok &= ok[c];
+      for (auto& l: chunks[c])
+        {
+          l.line += first_line;
+          lines.push_back(std::move(l));
+        }
+      first_line += newlines[c];
+    }
+  system_declaration_t* res = all_ok ? build_declarations(lines) : nullptr;
+  // The declarations hold copies of the strings, so we can unmap.
+  munmap(map, size);
+  return res;
+}
+
+#else // !HAVE_TCHECKER_DECLARATIONS
+
+tchecker::parsing::system_declaration_t*
+fast_parse_system_declaration(const std::string&)
+{
+  return nullptr;
+}
+
+#endif
@@ -0,0 +1,45 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <string>
+#include <tchecker/parsing/declaration.hh>
+
+// A fast loader for the text format of TChecker, for large generated
+// models.  The file is mapped in memory and tokenized in a single
+// pass (by several threads for large files), and the declarations
+// are built directly, without going through TChecker's parser.
+//
+// This loader only handles well-formed models.  On any syntax or
+// semantic error, or any construction it does not know, it returns
+// nullptr without reporting anything: the caller should then fall
+// back to tchecker::parsing::parse_system_declaration(), which will
+// produce the usual diagnostics.  It also returns nullptr when
+// TCLTL was built without it (HAVE_TCHECKER_DECLARATIONS).
+//
+// Only the parsing can be accelerated this way: the construction of
+// tchecker::zg::ta::model_t from the declarations (which compiles the
+// guards and statements) is left to TChecker, and cannot be cached
+// across processes since model_t cannot be serialized.
+//
+// This header is private: it relies on config.h.
+tchecker::parsing::system_declaration_t*
+fast_parse_system_declaration(const std::string& filename);
@@ -0,0 +1,38 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2019 Laboratoire de Recherche et Développement
+// de l'Epita (LRDE).
+//
+// This file is part of TCLTL, a model checker for timed-automata.
+//
+// TCLTL is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// TCLTL is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+// or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+// License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+// Static tracepoints (USDT) in the provider "tcltl".  When
+// <sys/sdt.h> is available, each probe compiles to a single nop plus
+// a note in the ELF file, so they cost nothing until a tracer such
+// as perf, bpftrace, or SystemTap attaches to them.  For instance:
+//
+//   perf probe -x src/.libs/libtcltl.so sdt_tcltl:state_alloc
+//   bpftrace -e 'usdt:src/.libs/libtcltl.so:tcltl:succ_iter_new
+//                { @[ustack] = count(); }'
+//
+// This header is private: it relies on config.h.
+
+#if HAVE_SYS_SDT_H
+#  include <sys/sdt.h>
+#  define TCLTL_PROBE2(name, a, b) STAP_PROBE2(tcltl, name, a, b)
+#else
+#  define TCLTL_PROBE2(name, a, b) do {} while (0)
+#endif
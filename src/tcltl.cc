@@ -21,9 +21,24 @@
 // A lot of code in this file is inspired from Spot's interface
 // with LTSmin, as seen in Spot's spot/ltsmin/ltsmin.cc file.
 
+#include "config.h"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <cassert>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <tchecker/parsing/parsing.hh>
 #include <tchecker/utils/log.hh>
@@ -32,8 +47,17 @@
 #include <tchecker/ts/builder.hh>
 
 #include <spot/misc/fixpool.hh>
+#include <spot/misc/version.hh>
+#include <spot/parseaut/public.hh>
+#include <spot/tl/print.hh>
+#include <spot/twa/twaproduct.hh>
+#include <spot/twaalgos/gtec/gtec.hh>
+#include <spot/twaalgos/hoa.hh>
+#include <spot/twaalgos/translate.hh>
 
 #include "tcltl.hh"
+#include "fastparse.hh"
+#include "probes.hh"
 
 
 // prop_list encodes the list of atomic propositions we have to
@@ -47,7 +71,7 @@
 // proposition in Spot's API.
 //
 // The actual evaluation of the prop_list is done in
-// tcltl_kripke::state_condition().  The conversion (or
+// tcltl_kripke::holds().  The conversion (or
 // "byte-compiling" if you prefer) from text to one_prop is
 // done by convert_aps().
 typedef enum { OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE, OP_GE, OP_AT } relop;
@@ -71,6 +95,12 @@ public:
   tchecker::log_t log = &os;
   const tchecker::parsing::system_declaration_t* sysdecl;
   tchecker::zg::ta::model_t* model;
+  // The text of a model loaded by load_from_string(), or the file of
+  // a model loaded by load() and its status at that time, for
+  // tc_model::source().
+  std::string text;
+  std::string filename;
+  struct stat file_status = {};
 
   std::string get_logs()
   {
@@ -193,20 +223,33 @@ public:
   {
     if (selfloop_)
       selfloop_->destroy();
+    --aut_->iterators_;
   }
 
 private:
   bool is_done() const
   {
+    // Once the budget is exhausted, no iterator has any successor
+    // left, so that the search in progress terminates normally.
+    if (SPOT_UNLIKELY(aut_->exhausted_))
+      return true;
     return selfloop_ ? done_ : pos_.at_end();
   }
 
+  bool visit() const
+  {
+    if (is_done())
+      return false;
+    ++aut_->stats_.transitions_visited;
+    return true;
+  }
+
 public:
   virtual bool first() override
   {
     pos_ = start_;
     done_ = false;
-    return !is_done();
+    return visit();
   }
 
   virtual bool next() override
@@ -215,7 +258,7 @@ public:
       done_ = true;
     else
       ++pos_;
-    return !is_done();
+    return visit();
   }
 
   virtual bool done() const override
@@ -225,6 +268,7 @@ public:
 
   virtual spot::state* dst() const override
   {
+    ++aut_->stats_.transitions_generated;
     if (selfloop_)
       return selfloop_->clone();
     auto [st, trans] = *pos_;
@@ -241,8 +285,175 @@ private:
 };
 
 
+// Resident memory of the process, or 0 if unknown.
+static size_t resident_bytes()
+{
+  // /proc/self/statm gives the total and resident sizes, in pages.
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (!f)
+    return 0;
+  unsigned long total;
+  unsigned long resident;
+  int n = fscanf(f, "%lu %lu", &total, &resident);
+  fclose(f);
+  if (n != 2)
+    return 0;
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+// The part of tcltl_kripke that does not depend on the zone
+// semantics.  This gives kripke_stats() a way to reach the counters
+// without knowing the template instance.
+class tcltl_kripke_base: public spot::kripke
+{
+public:
+  tcltl_kripke_base(const spot::bdd_dict_ptr& dict)
+    : kripke(dict)
+  {
+  }
+
+  // Updated by tcltl_kripke and its iterators.  Plain counters are
+  // enough since a Kripke structure is only explored by one thread.
+  // Read them with stats(), which computes the depth.
+  mutable tc_kripke_stats stats_;
+  // Number of successor iterators allocated and not yet deleted.
+  mutable unsigned long iterators_ = 0;
+
+  // The iterator kept in iter_cache_ by release_iter() has been
+  // popped by the caller, so it does not count in the depth.
+  // (release_iter() is not virtual, so it cannot do that itself.)
+  const tc_kripke_stats& stats() const
+  {
+    stats_.depth = iterators_ - (iter_cache_ != nullptr);
+    return stats_;
+  }
+
+  tc_kripke_memory memory() const
+  {
+    tc_kripke_memory res;
+    res.tchecker_state_bytes = tchecker_state_bytes_;
+    res.tchecker_used = stats_.tchecker_states_max * tchecker_state_bytes_;
+    unsigned long blocks =
+      (stats_.tchecker_states_max + pool_block_ - 1) / pool_block_;
+    res.tchecker_reserved = blocks * pool_block_ * tchecker_state_bytes_;
+    res.statepool = stats_.states_held_max * state_bytes_;
+    res.tofree = stats_.tofree_max * ptr_bytes_;
+    return res;
+  }
+
+  void set_progress(tc_progress* p, double period) const
+  {
+    progress_ = p;
+    progress_period_ = std::chrono::duration<double>(period);
+    progress_start_ = std::chrono::steady_clock::now();
+    progress_next_ = progress_start_ + progress_period_;
+  }
+
+  // Apply the limits of B from now on.
+  void set_budget(tc_budget* b) const
+  {
+    budget_ = b;
+    exhausted_ = false;
+    budget_states_ = stats_.states_visited;
+    budget_deadline_ = std::chrono::steady_clock::time_point::max();
+    if (b && b->timeout() > 0)
+      budget_deadline_ = std::chrono::steady_clock::now()
+        + std::chrono::duration_cast<std::chrono::steady_clock::duration>
+        (std::chrono::duration<double>(b->timeout()));
+  }
+
+  // Fill the names of the atomic propositions of SS, and the size of
+  // its bitsets.  See explore_state_space().
+  virtual void export_aps(tc_state_space& ss) const = 0;
+  // Append the locations, integer variables, DBM, and labels of ST to
+  // the arrays of SS, and set its dimensions on the first state.
+  virtual void export_state(const spot::state* st,
+                            tc_state_space& ss) const = 0;
+
+  tc_budget* budget() const
+  {
+    return budget_;
+  }
+
+  // Set once a limit of budget_ is hit, with that limit and the
+  // statistics at that point.  Throwing from succ_iter() instead
+  // would unwind through Spot's emptiness checks, which would leak
+  // the iterators and states of their stack.
+  mutable bool exhausted_ = false;
+  mutable tc_limit exhausted_limit_ = limit_cancelled;
+  mutable tc_kripke_stats exhausted_stats_;
+
+protected:
+  // Called by succ_iter(), before counting the state.  Like progress
+  // reports, the clock and the memory are only looked at every 256
+  // calls.
+  void check_budget() const
+  {
+    if (SPOT_LIKELY(!budget_) || exhausted_)
+      return;
+    if (budget_->max_states
+        && stats_.states_visited - budget_states_ >= budget_->max_states)
+      return exhaust(limit_states);
+    if (budget_->cancelled())
+      return exhaust(limit_cancelled);
+    if (stats_.states_visited & 255)
+      return;
+    if (std::chrono::steady_clock::now() >= budget_deadline_)
+      return exhaust(limit_time);
+    if (budget_->max_memory)
+      {
+        size_t used = resident_bytes();
+        if (!used)
+          {
+            tc_kripke_memory m = memory();
+            used = m.tchecker_reserved + m.statepool + m.tofree;
+          }
+        if (used > budget_->max_memory)
+          return exhaust(limit_memory);
+      }
+  }
+
+  void exhaust(tc_limit limit) const
+  {
+    exhausted_ = true;
+    exhausted_limit_ = limit;
+    exhausted_stats_ = stats();
+  }
+
+  // Called by succ_iter().  Looking at the clock only every 256 calls
+  // keeps the cost of this check negligible.
+  void maybe_report_progress() const
+  {
+    if (SPOT_LIKELY(!progress_ || (stats_.states_visited & 255)))
+      return;
+    auto now = std::chrono::steady_clock::now();
+    if (now < progress_next_)
+      return;
+    progress_next_ = now + progress_period_;
+    std::chrono::duration<double> elapsed = now - progress_start_;
+    progress_->report(stats(), elapsed.count());
+  }
+
+  // Filled by tcltl_kripke for memory().
+  size_t state_bytes_ = 0;
+  size_t ptr_bytes_ = 0;
+  size_t pool_block_ = 1;
+  mutable size_t tchecker_state_bytes_ = 0;
+
+private:
+  mutable tc_budget* budget_ = nullptr;
+  // The value of states_visited, and the deadline, when budget_ was
+  // applied.
+  mutable unsigned long budget_states_ = 0;
+  mutable std::chrono::steady_clock::time_point budget_deadline_;
+  mutable tc_progress* progress_ = nullptr;
+  mutable std::chrono::duration<double> progress_period_;
+  mutable std::chrono::steady_clock::time_point progress_start_;
+  mutable std::chrono::steady_clock::time_point progress_next_;
+};
+
 template <typename ZONE>
-class tcltl_kripke final: public spot::kripke
+class tcltl_kripke final: public tcltl_kripke_base
 {
 public:
   using zg_t = ZONE;
@@ -284,20 +495,38 @@ private:
   bdd alive_prop;
   bdd dead_prop;
   mutable spot::fixed_size_pool statepool_;
+  // Number of states allocated at once by TChecker's pools.
+  static constexpr unsigned pool_block = 100000;
+
+  // Approximate size of a TChecker state, including its tuple of
+  // locations, its valuation of integer variables, and its DBM.
+  static size_t tchecker_state_bytes(const state_ptr_t& st)
+  {
+    auto& vloc = st->vloc();
+    auto& vals = st->intvars_valuation();
+    auto& zone = st->zone();
+    return sizeof(state_t)
+      + sizeof(vloc) + vloc.size() * sizeof(void*)
+      + sizeof(vals) + vals.size() * sizeof(tchecker::integer_t)
+      + sizeof(zone) + zone.dim() * zone.dim() * sizeof(tchecker::dbm::db_t);
+  }
 public:
 
   tcltl_kripke(tc_model_details_ptr tcmd,
                const spot::bdd_dict_ptr& dict,
                const prop_list* ps, spot::formula dead)
-    : kripke(dict),
+    : tcltl_kripke_base(dict),
       tcmd_(tcmd),
       ts_(*tcmd->model),
       allocator_(unused_gc_,
-                 std::make_tuple(*tcmd->model, 100000), std::tuple<>()),
+                 std::make_tuple(*tcmd->model, pool_block), std::tuple<>()),
       builder_(ts_, allocator_),
       ps_(ps),
       statepool_(sizeof(tcltl_state_t))
   {
+    state_bytes_ = sizeof(tcltl_state_t);
+    ptr_bytes_ = sizeof(state_ptr_t);
+    pool_block_ = pool_block;
     // Register the "dead" proposition.  There are three cases to
     // consider:
     //  * If DEAD is "false", it means we are not interested in finite
@@ -354,7 +583,9 @@ public:
           typename builder_t::transition_ptr_t trans;
           std::tie(st, trans) = *it;
           first = false;
-          res = new(statepool_.allocate()) tcltl_state_t(this, st);
+          tchecker_state_bytes_ = tchecker_state_bytes(st);
+          res = new(allocate_state()) tcltl_state_t(this, st);
+          TCLTL_PROBE2(initial_state, this, res);
         }
       else
         {
@@ -367,6 +598,12 @@ public:
   tcltl_succiter_t* succ_iter(const spot::state* st) const override
   {
     check_tofree();
+    check_budget();
+    // The iterator of a state met after the budget is exhausted is
+    // empty: do not count that state.
+    if (SPOT_LIKELY(!exhausted_))
+      ++stats_.states_visited;
+    maybe_report_progress();
     auto zs = spot::down_cast<const tcltl_state_t*>(st);
     state_ptr_t& z = zs->zg_state();
     auto beg = builder_.outgoing(z).begin();
@@ -388,14 +625,26 @@ public:
           spot::down_cast<tcltl_succiter_t*>(iter_cache_);
         it->recycle(beg, scond, want_loop ? st->clone() : nullptr);
         iter_cache_ = nullptr;
+        ++stats_.iterators_recycled;
+        TCLTL_PROBE2(succ_iter_recycle, this, st);
         return it;
       }
+    ++iterators_;
+    TCLTL_PROBE2(succ_iter_new, this, st);
     return new tcltl_succiter_t(this, beg, scond,
                                 want_loop ? st->clone() : nullptr);
   }
 
   void* allocate_state() const
   {
+    ++stats_.states_generated;
+    TCLTL_PROBE2(state_alloc, this, stats_.states_generated);
+    unsigned long held = stats_.states_generated - stats_.states_released;
+    if (held > stats_.states_held_max)
+      stats_.states_held_max = held;
+    unsigned long alive = stats_.states_generated - stats_.states_freed;
+    if (alive > stats_.tchecker_states_max)
+      stats_.tchecker_states_max = alive;
     return statepool_.allocate();
   }
 
@@ -403,12 +652,17 @@ public:
   {
     // The front of the deque is the oldest element released, so it
     // should not be necessary to look elsewhere.
+    size_t before = tofree_.size();
     while (!tofree_.empty() && tofree_.front().refcount() == 1)
       {
         bool res = allocator_.destruct_state(tofree_.front());
         assert(res); (void) res;
         tofree_.pop_front();
       }
+    stats_.tofree = tofree_.size();
+    stats_.states_freed += before - stats_.tofree;
+    if (before != stats_.tofree)
+      TCLTL_PROBE2(tofree_reclaim, this, before - stats_.tofree);
   }
 
   void deallocate_state(const spot::state* st) const
@@ -423,55 +677,96 @@ public:
     //
     // Move so that it's as is zs was destroyed.
     tofree_.push_back(std::move(zs->zg_state()));
+    ++stats_.states_released;
+    stats_.tofree = tofree_.size();
+    if (stats_.tofree > stats_.tofree_max)
+      stats_.tofree_max = stats_.tofree;
+    TCLTL_PROBE2(state_free, this, stats_.tofree);
     statepool_.deallocate(const_cast<tcltl_state_t*>(zs));
   }
 
+  // Whether PROP holds in the state with valuation VALS and tuple of
+  // locations VLOC.
+  template <typename VALS, typename VLOC>
+  static bool holds(const one_prop& prop, const VALS& vals, const VLOC& vloc)
+  {
+    if (prop.op == OP_AT)
+      return vloc[prop.var_num]->id() == unsigned(prop.val);
+    int val = vals[prop.var_num];
+    int ref = prop.val;
+    switch (prop.op)
+      {
+      case OP_EQ:
+        return val == ref;
+      case OP_NE:
+        return val != ref;
+      case OP_LT:
+        return val < ref;
+      case OP_GT:
+        return val > ref;
+      case OP_LE:
+        return val <= ref;
+      case OP_GE:
+        return val >= ref;
+      case OP_AT:
+        // unreachable
+        break;
+      }
+    return false;
+  }
+
   virtual
   bdd state_condition(const spot::state* st) const override
   {
+    ++stats_.state_conditions;
+    TCLTL_PROBE2(state_condition, this, st);
     bdd cond = bddtrue;
     auto zs = spot::down_cast<const tcltl_state_t*>(st)->zg_state();
     auto& vals = zs->intvars_valuation();
     auto& vloc = zs->vloc();
     for (const one_prop& prop: *ps_)
+      cond &= (holds(prop, vals, vloc) ? bdd_ithvar : bdd_nithvar)
+        (prop.bddvar);
+    return cond;
+  }
+
+  void export_aps(tc_state_space& ss) const override
+  {
+    const spot::bdd_dict_ptr& d = get_dict();
+    for (const one_prop& prop: *ps_)
+      ss.ap_names.push_back(d->bdd_map[prop.bddvar].f.ap_name());
+    ss.label_bytes = (ps_->size() + 7) / 8;
+  }
+
+  void export_state(const spot::state* st, tc_state_space& ss) const override
+  {
+    static_assert(sizeof(tchecker::dbm::db_t) == sizeof(int32_t));
+    auto& zs = spot::down_cast<const tcltl_state_t*>(st)->zg_state();
+    auto& vloc = zs->vloc();
+    auto& vals = zs->intvars_valuation();
+    auto& zone = zs->zone();
+    unsigned dim = zone.dim();
+    if (ss.locations.empty())
       {
-        bool res = false;
-        if (prop.op == OP_AT)
-          {
-            res = vloc[prop.var_num]->id() == unsigned(prop.val);
-          }
-        else
-          {
-            int val = vals[prop.var_num];
-            int ref = prop.val;
-            switch (prop.op)
-              {
-              case OP_EQ:
-                res = val == ref;
-                break;
-              case OP_NE:
-                res = val != ref;
-                break;
-              case OP_LT:
-                res = val < ref;
-                break;
-              case OP_GT:
-                res = val > ref;
-                break;
-              case OP_LE:
-                res = val <= ref;
-                break;
-              case OP_GE:
-                res = val >= ref;
-                break;
-              case OP_AT:
-                // unreachable
-                break;
-              }
-          }
-        cond &= (res ? bdd_ithvar : bdd_nithvar)(prop.bddvar);
+        ss.processes = vloc.size();
+        ss.intvars = vals.size();
+        ss.dbm_dim = dim;
+      }
+    for (unsigned i = 0; i < vloc.size(); ++i)
+      ss.locations.push_back(vloc[i]->id());
+    for (unsigned i = 0; i < vals.size(); ++i)
+      ss.valuations.push_back(vals[i]);
+    const tchecker::dbm::db_t* dbm = zone.dbm();
+    ss.dbms.insert(ss.dbms.end(), dbm, dbm + dim * dim);
+    size_t base = ss.labels.size();
+    ss.labels.resize(base + ss.label_bytes, 0);
+    unsigned j = 0;
+    for (const one_prop& prop: *ps_)
+      {
+        if (holds(prop, vals, vloc))
+          ss.labels[base + j / 8] |= 1 << (j % 8);
+        ++j;
       }
-    return cond;
   }
 
   virtual
@@ -724,27 +1019,145 @@ void convert_aps(const spot::atomic_prop_set* aps,
     throw std::runtime_error(err.str());
 }
 
+// The receiver of set_tcltl_trace().
+static tc_trace* trace = nullptr;
+
+// TChecker's parser is generated by flex and bison, and keeps its
+// state in global variables, so only one thread may run it at a time.
+static std::mutex parser_mutex;
+
 tc_model::tc_model(tc_model_details* tcm)
   : priv_(tcm)
 {
 }
 
-tc_model tc_model::load(const std::string filename)
+tc_model tc_model::load(const std::string filename, bool fast_parser)
 {
   auto tcm = std::make_unique<tc_model_details>();
+  tcm->filename = filename;
+  stat(filename.c_str(), &tcm->file_status);
 
-  auto* sysdecl =
-    tchecker::parsing::parse_system_declaration(filename, tcm->log);
+  tchecker::parsing::system_declaration_t* sysdecl = nullptr;
+  if (fast_parser)
+    {
+      tc_trace_scope ts(trace, "fast_parse_system_declaration");
+      sysdecl = fast_parse_system_declaration(filename);
+    }
+  if (!sysdecl)
+    {
+      tc_trace_scope ts(trace, "parse_system_declaration");
+      std::lock_guard<std::mutex> lock(parser_mutex);
+      sysdecl =
+        tchecker::parsing::parse_system_declaration(filename, tcm->log);
+    }
 
   if (sysdecl == nullptr)
     throw std::runtime_error("System declaration could not be built.\n"
                              + tcm->get_logs());
 
   tcm->sysdecl = sysdecl;
+  tc_trace_scope ts(trace, "model_t");
   tcm->model = new tchecker::zg::ta::model_t(*sysdecl, tcm->log);
   return tc_model(tcm.release());
 }
 
+tc_model tc_model::load_from_string(const std::string& text,
+                                    bool fast_parser)
+{
+  int fd = -1;
+  std::string path;
+  bool temporary = false;
+#if HAVE_MEMFD_CREATE
+  fd = memfd_create("tcltl-model", MFD_CLOEXEC);
+  if (fd >= 0)
+    path = "/proc/self/fd/" + std::to_string(fd);
+#endif
+  if (fd < 0)
+    {
+      const char* tmpdir = getenv("TMPDIR");
+      path = std::string(tmpdir && *tmpdir ? tmpdir : "/tmp")
+        + "/tcltl-XXXXXX";
+      fd = mkstemp(&path[0]);
+      if (fd < 0)
+        throw std::runtime_error("cannot create " + path + ": "
+                                 + strerror(errno));
+      temporary = true;
+    }
+  auto cleanup = [&] {
+    close(fd);
+    if (temporary)
+      unlink(path.c_str());
+  };
+
+  // TChecker fails to parse a last line without newline.  See
+  // ticktac-project/tchecker#35.
+  std::string t = text;
+  if (t.empty() || t.back() != '\n')
+    t += '\n';
+  for (size_t done = 0; done < t.size();)
+    {
+      ssize_t w = write(fd, t.data() + done, t.size() - done);
+      if (w < 0 && errno == EINTR)
+        continue;
+      if (w < 0)
+        {
+          std::string err = strerror(errno);
+          cleanup();
+          throw std::runtime_error("cannot write " + path + ": " + err);
+        }
+      done += w;
+    }
+
+  try
+    {
+      tc_model res = load(path, fast_parser);
+      cleanup();
+      res.priv_->filename.clear();
+      res.priv_->text = text;
+      return res;
+    }
+  catch (...)
+    {
+      cleanup();
+      throw;
+    }
+}
+
+tc_model tc_model::load_from_stream(std::istream& in, bool fast_parser)
+{
+  std::ostringstream text;
+  // Copying an empty stream would set the failbit of TEXT.
+  if (in.peek() != std::char_traits<char>::eof())
+    text << in.rdbuf();
+  if (in.bad())
+    throw std::runtime_error("error reading model");
+  return load_from_string(text.str(), fast_parser);
+}
+
+std::string tc_model::source() const
+{
+  if (priv_->filename.empty())
+    return priv_->text;
+  const std::string& filename = priv_->filename;
+  std::ifstream in(filename);
+  struct stat st;
+  if (!in || stat(filename.c_str(), &st))
+    throw std::runtime_error("cannot read " + filename + ": "
+                             + strerror(errno));
+  const struct stat& old = priv_->file_status;
+  if (st.st_dev != old.st_dev || st.st_ino != old.st_ino
+      || st.st_size != old.st_size
+      || st.st_mtim.tv_sec != old.st_mtim.tv_sec
+      || st.st_mtim.tv_nsec != old.st_mtim.tv_nsec)
+    throw std::runtime_error(filename + " was modified since the model "
+                             "was loaded");
+  std::ostringstream text;
+  text << in.rdbuf();
+  if (in.bad())
+    throw std::runtime_error("error reading " + filename);
+  return text.str();
+}
+
 std::string tc_model::get_logs() const
 {
   return priv_->get_logs();
@@ -831,6 +1244,7 @@ spot::kripke_ptr tc_model::kripke(const spot::atomic_prop_set* to_observe,
   prop_list* ps = new prop_list;
   try
     {
+      tc_trace_scope ts(trace, "convert_aps");
       convert_aps(to_observe, *priv_->model, dict, dead, *ps);
     }
   catch (const std::runtime_error&)
@@ -852,3 +1266,542 @@ spot::kripke_ptr tc_model::kripke(const spot::atomic_prop_set* to_observe,
     res->register_ap(dead);
   return res;
 }
+
+const tc_kripke_stats* kripke_stats(const spot::const_twa_ptr& k)
+{
+  auto tk = std::dynamic_pointer_cast<const tcltl_kripke_base>(k);
+  if (!tk)
+    return nullptr;
+  return &tk->stats();
+}
+
+tc_kripke_memory kripke_memory(const spot::const_twa_ptr& k)
+{
+  auto tk = std::dynamic_pointer_cast<const tcltl_kripke_base>(k);
+  if (!tk)
+    return tc_kripke_memory();
+  return tk->memory();
+}
+
+tc_progress::~tc_progress()
+{
+}
+
+void set_kripke_progress(const spot::const_twa_ptr& k,
+                         tc_progress* p, double period)
+{
+  auto tk = std::dynamic_pointer_cast<const tcltl_kripke_base>(k);
+  if (!tk)
+    throw std::runtime_error("set_kripke_progress() expects a Kripke "
+                             "structure built by tc_model::kripke()");
+  tk->set_progress(p, period);
+}
+
+static const char* limit_message(tc_limit limit)
+{
+  switch (limit)
+    {
+    case limit_states:
+      return "state limit reached";
+    case limit_memory:
+      return "memory limit reached";
+    case limit_time:
+      return "time limit reached";
+    case limit_cancelled:
+      return "exploration cancelled";
+    }
+  // unreachable
+  assert(0);
+  return nullptr;
+}
+
+tc_budget_exceeded::tc_budget_exceeded(tc_limit limit,
+                                       const tc_kripke_stats& stats)
+  : std::runtime_error(limit_message(limit)), limit(limit), stats(stats)
+{
+}
+
+void set_kripke_budget(const spot::const_twa_ptr& k, tc_budget* b)
+{
+  auto tk = std::dynamic_pointer_cast<const tcltl_kripke_base>(k);
+  if (!tk)
+    throw std::runtime_error("set_kripke_budget() expects a Kripke "
+                             "structure built by tc_model::kripke()");
+  tk->set_budget(b);
+}
+
+void check_kripke_budget(const spot::const_twa_ptr& k)
+{
+  auto tk = std::dynamic_pointer_cast<const tcltl_kripke_base>(k);
+  if (!tk)
+    throw std::runtime_error("check_kripke_budget() expects a Kripke "
+                             "structure built by tc_model::kripke()");
+  if (tk->exhausted_)
+    throw tc_budget_exceeded(tk->exhausted_limit_, tk->exhausted_stats_);
+}
+
+tc_check_result model_check(const spot::const_twa_ptr& k,
+                            const spot::const_twa_ptr& neg_aut,
+                            tc_budget* b)
+{
+  auto tk = std::dynamic_pointer_cast<const tcltl_kripke_base>(k);
+  if (!tk)
+    throw std::runtime_error("model_check() expects a Kripke "
+                             "structure built by tc_model::kripke()");
+  tc_budget* old = tk->budget();
+  // Start counting the limits now, even with the budget of K.
+  tk->set_budget(b ? b : old);
+  tc_check_result res;
+  try
+    {
+      // This is what twa::intersecting_run() does, with a look at the
+      // budget between the emptiness check and the construction of
+      // the counterexample.
+      auto ec = spot::couvreur99(spot::otf_product(k, neg_aut));
+      spot::emptiness_check_result_ptr ecr = ec->check();
+      if (tk->exhausted_)
+        {
+          res.verdict = verdict_unknown;
+          res.limit = tk->exhausted_limit_;
+          res.reason = limit_message(res.limit);
+          res.stats = tk->exhausted_stats_;
+        }
+      else
+        {
+          res.stats = tk->stats();
+          if (ecr)
+            {
+              // The counterexample is built by exploring the product
+              // again, which the budget should not interrupt.
+              tk->set_budget(nullptr);
+              res.run = ecr->accepting_run()->project(k);
+            }
+          res.verdict = res.run ? verdict_violated : verdict_satisfied;
+        }
+    }
+  catch (...)
+    {
+      tk->set_budget(old);
+      throw;
+    }
+  tk->set_budget(old);
+  return res;
+}
+
+// The statistics sent by the process of a tc_async_check, in the
+// order of tc_kripke_stats.
+static void write_stats(std::ostream& os, const tc_kripke_stats& s)
+{
+  os << s.states_generated << ' ' << s.states_visited << ' '
+     << s.transitions_generated << ' ' << s.transitions_visited << ' '
+     << s.iterators_recycled << ' ' << s.state_conditions << ' '
+     << s.tofree_max << ' ' << s.tofree << ' ' << s.depth << ' '
+     << s.states_released << ' ' << s.states_freed << ' '
+     << s.states_held_max << ' ' << s.tchecker_states_max;
+}
+
+static void read_stats(std::istream& is, tc_kripke_stats& s)
+{
+  is >> s.states_generated >> s.states_visited
+     >> s.transitions_generated >> s.transitions_visited
+     >> s.iterators_recycled >> s.state_conditions
+     >> s.tofree_max >> s.tofree >> s.depth
+     >> s.states_released >> s.states_freed
+     >> s.states_held_max >> s.tchecker_states_max;
+}
+
+static bool write_all(int fd, const std::string& s)
+{
+  const char* p = s.data();
+  size_t left = s.size();
+  while (left)
+    {
+      ssize_t n = write(fd, p, left);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      p += n;
+      left -= n;
+    }
+  return true;
+}
+
+// The budget cancelled by SIGTERM in the process of a tc_async_check.
+static tc_budget* async_budget = nullptr;
+
+static void async_cancel(int)
+{
+  async_budget->cancel();
+}
+
+// Report the progress of a tc_async_check on its pipe, one line per
+// report.  The pipe is non-blocking, and a line is shorter than
+// PIPE_BUF so it is written entirely or not at all: reports are
+// dropped if the parent does not read them, instead of blocking the
+// check.
+class async_progress final: public tc_progress
+{
+public:
+  async_progress(int fd)
+    : fd_(fd)
+  {
+  }
+
+  void report(const tc_kripke_stats& s, double elapsed) override
+  {
+    std::ostringstream os;
+    os.precision(17);
+    os << "P " << elapsed << ' ' << resident_bytes() << ' ';
+    write_stats(os, s);
+    os << '\n';
+    std::string line = os.str();
+    ssize_t n = write(fd_, line.data(), line.size());
+    (void) n;
+  }
+private:
+  int fd_;
+};
+
+// The process of a tc_async_check.  The result is written as an "R"
+// line with the verdict, the limit and the statistics, followed by
+// the reason, and the counterexample until the end.  Errors are
+// written as "E" followed by the message.
+[[noreturn]] static void
+async_check_child(int fd, const spot::const_twa_ptr& k,
+                  const spot::const_twa_ptr& neg_aut,
+                  tc_budget* b, double period)
+{
+  tc_budget local;
+  async_budget = b ? b : &local;
+  signal(SIGTERM, async_cancel);
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  async_progress progress(fd);
+  std::ostringstream os;
+  try
+    {
+      // This also replaces any progress handler of the parent, which
+      // might not work in this process (e.g., one written in Python).
+      set_kripke_progress(k, period > 0 ? &progress : nullptr, period);
+      tc_check_result r = model_check(k, neg_aut, async_budget);
+      os << "R " << r.verdict << ' ' << r.limit << ' ';
+      write_stats(os, r.stats);
+      os << '\n' << r.reason << '\n';
+      if (r.run)
+        os << *r.run;
+    }
+  catch (const std::exception& e)
+    {
+      os.str("");
+      os << "E\n" << e.what();
+    }
+  fcntl(fd, F_SETFL, 0);
+  write_all(fd, os.str());
+  _exit(0);
+}
+
+tc_async_check::tc_async_check(const spot::const_twa_ptr& k,
+                               const spot::const_twa_ptr& neg_aut,
+                               tc_budget* b, double period)
+{
+  if (!kripke_stats(k))
+    throw std::runtime_error("tc_async_check expects a Kripke "
+                             "structure built by tc_model::kripke()");
+  int fds[2];
+  if (pipe(fds))
+    throw std::runtime_error(std::string("pipe: ") + strerror(errno));
+  // Do not let the child flush a copy of our buffers.
+  std::cout.flush();
+  std::cerr.flush();
+  fflush(nullptr);
+  pid_ = fork();
+  if (pid_ < 0)
+    {
+      close(fds[0]);
+      close(fds[1]);
+      throw std::runtime_error(std::string("fork: ") + strerror(errno));
+    }
+  if (pid_ == 0)
+    {
+      close(fds[0]);
+      async_check_child(fds[1], k, neg_aut, b, period);
+    }
+  close(fds[1]);
+  fd_ = fds[0];
+  fcntl(fd_, F_SETFL, O_NONBLOCK);
+}
+
+tc_async_check::~tc_async_check()
+{
+  if (!done_)
+    {
+      kill(pid_, SIGKILL);
+      while (waitpid(pid_, nullptr, 0) < 0 && errno == EINTR)
+        continue;
+    }
+  close(fd_);
+}
+
+bool tc_async_check::update()
+{
+  if (done_)
+    return true;
+  char buf[4096];
+  for (;;)
+    {
+      ssize_t n = read(fd_, buf, sizeof buf);
+      if (n > 0)
+        {
+          buffer_.append(buf, n);
+          continue;
+        }
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        break;
+      finish();
+      break;
+    }
+  size_t eol;
+  while (!buffer_.empty() && buffer_[0] == 'P'
+         && (eol = buffer_.find('\n')) != std::string::npos)
+    {
+      std::istringstream is(buffer_.substr(2, eol - 2));
+      tc_async_progress p;
+      is >> p.elapsed >> p.rss;
+      read_stats(is, p.stats);
+      if (p.elapsed > progress_.elapsed)
+        p.rate = (p.stats.states_generated - progress_.stats.states_generated)
+          / (p.elapsed - progress_.elapsed);
+      progress_ = p;
+      buffer_.erase(0, eol + 1);
+    }
+  return done_;
+}
+
+// Called once the pipe is closed: reap the process and decode its
+// result.
+void tc_async_check::finish()
+{
+  int wstatus = 0;
+  while (waitpid(pid_, &wstatus, 0) < 0 && errno == EINTR)
+    continue;
+  done_ = true;
+  // Progress lines may precede the result.
+  size_t pos = 0;
+  while (pos < buffer_.size() && buffer_[pos] == 'P')
+    {
+      size_t eol = buffer_.find('\n', pos);
+      if (eol == std::string::npos)
+        break;
+      pos = eol + 1;
+    }
+  if (buffer_.compare(pos, 2, "R ") == 0)
+    {
+      size_t eol = buffer_.find('\n', pos);
+      std::istringstream is(buffer_.substr(pos + 2, eol - pos - 2));
+      int verdict;
+      int limit;
+      is >> verdict >> limit;
+      result_.verdict = tc_verdict(verdict);
+      result_.limit = tc_limit(limit);
+      read_stats(is, result_.stats);
+      size_t eor = buffer_.find('\n', eol + 1);
+      result_.reason = buffer_.substr(eol + 1, eor - eol - 1);
+      if (eor != std::string::npos)
+        counterexample_ = buffer_.substr(eor + 1);
+    }
+  else if (buffer_.compare(pos, 2, "E\n") == 0)
+    {
+      error_ = buffer_.substr(pos + 2);
+    }
+  else if (WIFSIGNALED(wstatus) && WTERMSIG(wstatus) == SIGTERM)
+    {
+      // cancel() was called before the process could catch SIGTERM.
+      result_.limit = limit_cancelled;
+      result_.reason = "exploration cancelled";
+      result_.stats = progress_.stats;
+    }
+  else if (WIFSIGNALED(wstatus))
+    {
+      error_ = std::string("the check was killed by signal ")
+        + strsignal(WTERMSIG(wstatus));
+    }
+  else
+    {
+      error_ = "the check terminated without reporting";
+    }
+  // Keep the progress lines for update().
+  buffer_.erase(pos);
+}
+
+void tc_async_check::cancel()
+{
+  if (!done_)
+    kill(pid_, SIGTERM);
+}
+
+tc_check_result tc_async_check::result()
+{
+  while (!update())
+    {
+      pollfd p = { fd_, POLLIN, 0 };
+      if (poll(&p, 1, -1) < 0 && errno != EINTR)
+        throw std::runtime_error(std::string("poll: ") + strerror(errno));
+    }
+  if (!error_.empty())
+    throw std::runtime_error(error_);
+  return result_;
+}
+
+std::string tc_async_check::counterexample()
+{
+  result();
+  return counterexample_;
+}
+
+tc_state_space explore_state_space(const spot::const_twa_ptr& k,
+                                   tc_budget* b)
+{
+  auto tk = std::dynamic_pointer_cast<const tcltl_kripke_base>(k);
+  if (!tk)
+    throw std::runtime_error("explore_state_space() expects a Kripke "
+                             "structure built by tc_model::kripke()");
+  tc_budget* old = tk->budget();
+  // Start counting the limits now, even with the budget of K.
+  tk->set_budget(b ? b : old);
+  tc_state_space ss;
+  tk->export_aps(ss);
+  // States are numbered in the order they are discovered by a
+  // breadth-first search, so ORDER is also the queue.
+  spot::state_map<unsigned> seen;
+  std::vector<const spot::state*> order;
+  const spot::state* init = k->get_init_state();
+  seen.emplace(init, 0);
+  order.push_back(init);
+  ss.edge_offsets.push_back(0);
+  try
+    {
+      for (size_t i = 0; i < order.size(); ++i)
+        {
+          tk->export_state(order[i], ss);
+          spot::twa_succ_iterator* it = k->succ_iter(order[i]);
+          for (bool ok = it->first(); ok; ok = it->next())
+            {
+              const spot::state* dst = it->dst();
+              auto [p, inserted] = seen.emplace(dst, order.size());
+              if (inserted)
+                order.push_back(dst);
+              else
+                dst->destroy();
+              ss.edge_targets.push_back(p->second);
+            }
+          k->release_iter(it);
+          ss.edge_offsets.push_back(ss.edge_targets.size());
+        }
+    }
+  catch (...)
+    {
+      for (const spot::state* s: order)
+        s->destroy();
+      tk->set_budget(old);
+      throw;
+    }
+  for (const spot::state* s: order)
+    s->destroy();
+  bool exhausted = tk->exhausted_;
+  tc_limit limit = tk->exhausted_limit_;
+  tc_kripke_stats stats = tk->exhausted_stats_;
+  tk->set_budget(old);
+  if (exhausted)
+    throw tc_budget_exceeded(limit, stats);
+  ss.states = order.size();
+  return ss;
+}
+
+tc_trace::~tc_trace()
+{
+}
+
+void set_tcltl_trace(tc_trace* t)
+{
+  trace = t;
+}
+
+// The directory of translate_cached(), or "" if caching is disabled.
+static std::string translation_cache_dir()
+{
+  if (const char* dir = getenv("TCLTL_CACHE_DIR"))
+    return dir;
+  if (const char* dir = getenv("XDG_CACHE_HOME"); dir && *dir)
+    return std::string(dir) + "/tcltl";
+  if (const char* dir = getenv("HOME"); dir && *dir)
+    return std::string(dir) + "/.cache/tcltl";
+  return "";
+}
+
+// Create DIR and its parents.
+static bool make_dirs(const std::string& dir)
+{
+  for (size_t pos = 1; pos <= dir.size(); ++pos)
+    if (pos == dir.size() || dir[pos] == '/')
+      if (mkdir(dir.substr(0, pos).c_str(), 0777) && errno != EEXIST)
+        return false;
+  return true;
+}
+
+spot::twa_graph_ptr
+translate_cached(spot::formula formula, spot::bdd_dict_ptr dict)
+{
+  auto translate = [&] { return spot::translator(dict).run(formula); };
+  std::string dir = translation_cache_dir();
+  if (dir.empty())
+    return translate();
+
+  // The key is stored as the name of the automaton, so that a
+  // collision of the hash used as filename is detected.
+  std::string key = std::string("spot ") + spot::version()
+    + ", tgba small high, " + spot::str_psl(formula);
+  // 64-bit FNV-1a.
+  unsigned long long h = 14695981039346656037ULL;
+  for (unsigned char c: key)
+    h = (h ^ c) * 1099511628211ULL;
+  char name[32];
+  snprintf(name, sizeof name, "/%016llx.hoa", h);
+  std::string filename = dir + name;
+
+  if (access(filename.c_str(), R_OK) == 0)
+    {
+      spot::parsed_aut_ptr pa = spot::parse_aut(filename, dict);
+      std::ostringstream ignored;
+      if (!pa->format_errors(ignored) && pa->aut)
+        if (auto n = pa->aut->get_named_prop<std::string>("automaton-name");
+            n && *n == key)
+          {
+            pa->aut->set_named_prop("automaton-name", nullptr);
+            return pa->aut;
+          }
+    }
+
+  spot::twa_graph_ptr aut = translate();
+  if (!make_dirs(dir))
+    return aut;
+  // Write to a temporary file, renamed once complete, so that
+  // concurrent processes never read a partial automaton.
+  std::string tmp = filename + "." + std::to_string(getpid());
+  {
+    std::ofstream out(tmp);
+    aut->set_named_prop("automaton-name", new std::string(key));
+    spot::print_hoa(out, aut);
+    aut->set_named_prop("automaton-name", nullptr);
+    out.close();
+    if (!out)
+      {
+        unlink(tmp.c_str());
+        return aut;
+      }
+  }
+  if (rename(tmp.c_str(), filename.c_str()))
+    unlink(tmp.c_str());
+  return aut;
+}
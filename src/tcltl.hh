@@ -19,11 +19,19 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <sys/types.h>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <spot/tl/apcollect.hh>
 #include <spot/kripke/kripke.hh>
 #include <spot/tl/formula.hh>
+#include <spot/twa/twagraph.hh>
+#include <spot/twaalgos/emptiness.hh>
 
 #ifdef TCLTL_BUILD
   #define TCLTL_API SPOT_HELPER_DLL_EXPORT
@@ -56,6 +64,198 @@ enum zg_zone_semantics
    non_elapsed_extraMplus_local,
   };
 
+// Statistics about the exploration of a Kripke structure built by
+// tc_model::kripke().  These counters are maintained by every such
+// Kripke structure, as they only cost one increment per operation.
+struct tc_kripke_stats
+{
+  // Number of states allocated (the initial state and all the
+  // successors returned by the successor iterators).
+  unsigned long states_generated = 0;
+  // Number of calls to succ_iter(), i.e., of states whose successors
+  // have been requested.
+  unsigned long states_visited = 0;
+  // Number of successor states built by dst().
+  unsigned long transitions_generated = 0;
+  // Number of transitions the successor iterators have stepped on.
+  unsigned long transitions_visited = 0;
+  // Number of succ_iter() calls that recycled an old iterator instead
+  // of allocating a new one.
+  unsigned long iterators_recycled = 0;
+  // Number of calls to state_condition().
+  unsigned long state_conditions = 0;
+  // Largest number of TChecker states waiting to be freed.
+  unsigned long tofree_max = 0;
+  // Current number of TChecker states waiting to be freed.
+  unsigned long tofree = 0;
+  // Current number of successor iterators in use.  During a DFS,
+  // this is the depth of the search stack.
+  unsigned long depth = 0;
+  // Number of states released by the caller.  Their TChecker state
+  // is then queued for freeing.
+  unsigned long states_released = 0;
+  // Number of TChecker states actually freed.
+  unsigned long states_freed = 0;
+  // Largest number of states simultaneously held by the caller.
+  unsigned long states_held_max = 0;
+  // Largest number of TChecker states simultaneously allocated
+  // (including those waiting to be freed).
+  unsigned long tchecker_states_max = 0;
+};
+
+// Estimated peak memory used by the parts of a Kripke structure built
+// by tc_model::kripke(), in bytes.  See kripke_memory().
+struct tc_kripke_memory
+{
+  // Size of one TChecker state, including its tuple of locations, its
+  // valuation of integer variables, and its DBM.
+  size_t tchecker_state_bytes = 0;
+  // Memory used by TChecker states at the peak of the exploration,
+  // and memory reserved by TChecker's pools to hold them (they grow
+  // by large blocks, and never shrink).
+  size_t tchecker_used = 0;
+  size_t tchecker_reserved = 0;
+  // Memory used by the wrappers of the states (in statepool_).
+  size_t statepool = 0;
+  // Memory used by the backlog of states waiting to be freed (the
+  // TChecker states themselves are counted in tchecker_used).
+  size_t tofree = 0;
+};
+
+// Receive periodic reports while a Kripke structure built by
+// tc_model::kripke() is being explored.  See set_kripke_progress().
+class TCLTL_API tc_progress
+{
+public:
+  virtual ~tc_progress();
+
+  // Called with the current statistics of the Kripke structure, and
+  // the number of seconds since progress reporting was enabled.
+  virtual void report(const tc_kripke_stats& stats, double elapsed) = 0;
+};
+
+// Receive the begin and end of the phases of the library (parsing
+// of the model, construction of TChecker's model, conversion of the
+// atomic propositions), e.g., to build a timeline.  See
+// set_tcltl_trace().
+class TCLTL_API tc_trace
+{
+public:
+  virtual ~tc_trace();
+
+  // NAME is a string literal; a call to end() always matches the last
+  // unmatched call to begin().
+  virtual void begin(const char* name) = 0;
+  virtual void end(const char* name) = 0;
+};
+
+// Call T->begin(NAME) on construction, and T->end(NAME) on
+// destruction, unless T is nullptr.
+class tc_trace_scope final
+{
+public:
+  tc_trace_scope(tc_trace* t, const char* name)
+    : t_(t), name_(name)
+  {
+    if (t_)
+      t_->begin(name_);
+  }
+
+  ~tc_trace_scope()
+  {
+    if (t_)
+      t_->end(name_);
+  }
+
+  tc_trace_scope(const tc_trace_scope&) = delete;
+  tc_trace_scope& operator=(const tc_trace_scope&) = delete;
+private:
+  tc_trace* t_;
+  const char* name_;
+};
+
+// Limits on the exploration of a Kripke structure built by
+// tc_model::kripke().  See set_kripke_budget() and model_check().
+// The limits on the states and the time apply to each exploration
+// separately: they count from the start of each model_check() or
+// explore_state_space(), or else from set_kripke_budget().
+//
+// The limits are checked by succ_iter(): the number of states and
+// the cancellation flag on every call, the clock and the memory
+// every 256 calls.  When a limit is exceeded, the Kripke structure
+// stops giving successors, so that the search in progress ends
+// normally (an exception would leak the stack of Spot's emptiness
+// checks).  model_check() then gives verdict_unknown; after another
+// algorithm, call check_kripke_budget() to know whether its result is
+// complete.
+class TCLTL_API tc_budget final
+{
+public:
+  // Maximum number of states whose successors may be requested
+  // (states_visited in tc_kripke_stats) by one exploration, or 0 for
+  // no limit.
+  unsigned long max_states = 0;
+  // Maximum resident memory of the whole process, in bytes, or 0 for
+  // no limit.  It is read from /proc/self/statm; where this file
+  // does not exist, the estimate of kripke_memory() is used instead.
+  size_t max_memory = 0;
+
+  // Stop each exploration SECONDS after its start.  A SECONDS <= 0
+  // removes the limit.
+  void set_timeout(double seconds)
+  {
+    timeout_ = seconds > 0 ? seconds : 0;
+  }
+
+  double timeout() const
+  {
+    return timeout_;
+  }
+
+  // Stop the exploration as soon as possible.  This may be called
+  // from another thread, or from a signal handler.
+  void cancel()
+  {
+    cancelled_ = true;
+  }
+
+  bool cancelled() const
+  {
+    return cancelled_;
+  }
+
+  // Forget a previous cancel().
+  void reset()
+  {
+    cancelled_ = false;
+  }
+
+private:
+  double timeout_ = 0;
+  std::atomic<bool> cancelled_{false};
+};
+
+// The limits of a tc_budget.
+enum tc_limit
+  {
+   limit_states,
+   limit_memory,
+   limit_time,
+   limit_cancelled,
+  };
+
+// Thrown by check_kripke_budget() and explore_state_space() when the
+// budget of a Kripke structure is exhausted.
+class TCLTL_API tc_budget_exceeded final: public std::runtime_error
+{
+public:
+  tc_budget_exceeded(tc_limit limit, const tc_kripke_stats& stats);
+
+  tc_limit limit;
+  // The statistics of the Kripke structure when the limit was hit.
+  // In particular, depth is the depth of the search at that point.
+  tc_kripke_stats stats;
+};
 
 class TCLTL_API tc_model final
 {
@@ -65,9 +265,39 @@ private:
 public:
   // Load a TChecker model.
   //
+  // If FAST_PARSER is set, first try a faster parser for large
+  // generated models.  It falls back to TChecker's parser on models
+  // it cannot handle, including erroneous ones, so the diagnostics
+  // are the same.
+  //
+  // Loading does not involve Spot or BuDDy, so it may run in a
+  // thread while another one uses them, e.g., to translate the
+  // formula.  Several threads may also load models at the same time:
+  // only TChecker's parser is serialized, not the fast parser nor the
+  // construction of the model.
+  //
   // This will throw an exception on error.
-  static tc_model load(const std::string filename);
+  static tc_model load(const std::string filename, bool fast_parser = false);
+
+  // Load a TChecker model from its text, or from a stream.
+  //
+  // TChecker's parser can only read files, so the text is given to it
+  // as an anonymous file in memory where memfd_create() is supported,
+  // or as a temporary file otherwise.  This will throw an exception
+  // on error.
+  static tc_model load_from_string(const std::string& text,
+                                   bool fast_parser = false);
+  static tc_model load_from_stream(std::istream& in,
+                                   bool fast_parser = false);
+
 
+  // Return the text of the model, so that another process can load
+  // it with load_from_string(), e.g., after pickling it from Python.
+  // The model_t built by TChecker cannot be serialized, so the other
+  // process has to build it again.  A model loaded by load() is read
+  // again from its file, and this throws std::runtime_error if that
+  // file was removed or modified since.
+  std::string source() const;
 
   // Return any warnings that was output while instantiating the
   // model.  Calling this function will clear the logs.
@@ -91,6 +321,10 @@ public:
   //
   // This function returns nullptr on error.
   //
+  // The Kripke structure, like the bdd_dict, uses BuDDy, which is not
+  // thread-safe.  This function, and the exploration of the result,
+  // must not run concurrently with any other use of BuDDy.
+  //
   // \a to_observe the list of atomic propositions that should be observed
   //               in the model
   // \a dict the BDD dictionary to use
@@ -103,3 +337,206 @@ public:
                           zg_zone_semantics zone_sem =
                           elapsed_extraLUplus_local);
 };
+
+// Return the statistics of a Kripke structure created by
+// tc_model::kripke(), or nullptr if K was not created this way.
+TCLTL_API const tc_kripke_stats* kripke_stats(const spot::const_twa_ptr& k);
+
+// Estimate the peak memory used by K, or return all zeros if K was not
+// created by tc_model::kripke().  This is computed from the counters
+// of kripke_stats() and the sizes of the structures involved.
+TCLTL_API tc_kripke_memory kripke_memory(const spot::const_twa_ptr& k);
+
+// Have K call P->report() about every PERIOD seconds while it is
+// explored.  The clock is only checked from succ_iter(), every few
+// hundred calls, so that this costs nothing noticeable.  P is not
+// owned by K, and must outlive the exploration.  Passing nullptr
+// disables reporting.  This throws std::runtime_error if K was not
+// created by tc_model::kripke().
+TCLTL_API void set_kripke_progress(const spot::const_twa_ptr& k,
+                                   tc_progress* p, double period = 1.0);
+
+// Have K check the limits of B while it is explored, counting the
+// states and the time from this call.  B is not owned by K, and must
+// outlive the exploration.  Passing nullptr removes
+// the limits.  This throws std::runtime_error if K was not created
+// by tc_model::kripke().
+TCLTL_API void set_kripke_budget(const spot::const_twa_ptr& k, tc_budget* b);
+
+// Throw tc_budget_exceeded if the exploration of K has been cut short
+// by a limit of its budget since that budget was applied.  The result
+// of any algorithm run on K since then is then unreliable (e.g., an
+// emptiness check may have missed a counterexample).  This throws
+// std::runtime_error if K was not created by tc_model::kripke().
+TCLTL_API void check_kripke_budget(const spot::const_twa_ptr& k);
+
+enum tc_verdict
+  {
+   verdict_satisfied,
+   verdict_violated,
+   verdict_unknown,
+  };
+
+// The result of model_check().
+struct tc_check_result
+{
+  tc_verdict verdict = verdict_unknown;
+  // When the verdict is verdict_violated, a run of the Kripke
+  // structure accepted by the automaton.
+  spot::twa_run_ptr run = nullptr;
+  // When the verdict is verdict_unknown, the limit that was hit.
+  tc_limit limit = limit_cancelled;
+  std::string reason;
+  // The statistics of the Kripke structure at the end of the check,
+  // or when the limit was hit.
+  tc_kripke_stats stats;
+};
+
+// Check whether the Kripke structure K, built by tc_model::kripke(),
+// has a run accepted by NEG_AUT, the automaton of the negation of the
+// property.  If B is given, it replaces the budget of K for the
+// duration of the check.  Either way, the limits count from the start
+// of the check, so that K may be checked against several properties.
+// Hitting a limit of the budget results in verdict_unknown, instead
+// of an exception.
+TCLTL_API tc_check_result model_check(const spot::const_twa_ptr& k,
+                                      const spot::const_twa_ptr& neg_aut,
+                                      tc_budget* b = nullptr);
+
+// The last progress report of a tc_async_check.
+struct tc_async_progress
+{
+  tc_kripke_stats stats;
+  // Seconds since the check started.
+  double elapsed = 0.0;
+  // Resident memory of the process running the check, in bytes.
+  size_t rss = 0;
+  // States generated per second since the previous report.
+  double rate = 0.0;
+};
+
+// Run model_check() in the background, and follow it.
+//
+// Since BuDDy is not thread-safe, the check runs in a forked process
+// rather than in a thread, so that the caller may keep using Spot
+// meanwhile.  The process reports its progress and its result through
+// a pipe; update() reads them without blocking, and fd() may be
+// watched by an event loop to know when to call it.
+class TCLTL_API tc_async_check final
+{
+public:
+  // Start checking K (built by tc_model::kripke()) against NEG_AUT.
+  // The limits of B (if given) apply to the check, and progress is
+  // reported every PERIOD seconds.  B is copied into the process:
+  // cancelling it afterwards has no effect, use cancel() instead.
+  // This throws std::runtime_error if the process cannot be started.
+  tc_async_check(const spot::const_twa_ptr& k,
+                 const spot::const_twa_ptr& neg_aut,
+                 tc_budget* b = nullptr, double period = 0.2);
+  // Kill the process if it is still running.
+  ~tc_async_check();
+
+  tc_async_check(const tc_async_check&) = delete;
+  tc_async_check& operator=(const tc_async_check&) = delete;
+
+  // A descriptor that becomes readable when update() has something to
+  // read.
+  int fd() const
+  {
+    return fd_;
+  }
+
+  // Read the available reports without blocking, and return done().
+  bool update();
+
+  // Whether the result is known.
+  bool done() const
+  {
+    return done_;
+  }
+
+  // Ask the check to stop.  Its result will then be verdict_unknown
+  // (with limit_cancelled), unless it was already decided.
+  void cancel();
+
+  // The last progress report.  This and result() return copies, so
+  // that they remain valid after this object is destroyed.
+  tc_async_progress progress() const
+  {
+    return progress_;
+  }
+
+  // Wait for the result.  Its run is always nullptr: the
+  // counterexample is given as text by counterexample().  This throws
+  // std::runtime_error if the check failed.
+  tc_check_result result();
+  std::string counterexample();
+
+private:
+  void finish();
+
+  pid_t pid_;
+  int fd_;
+  bool done_ = false;
+  std::string buffer_;
+  std::string error_;
+  std::string counterexample_;
+  tc_async_progress progress_;
+  tc_check_result result_;
+};
+
+// The reachable states of a Kripke structure built by
+// tc_model::kripke(), as flat arrays for analysis tools (the Python
+// bindings expose them as NumPy arrays without copying them).  See
+// explore_state_space().  States are numbered from 0 (the initial
+// state) in breadth-first order, and matrices are stored row-major.
+struct tc_state_space
+{
+  unsigned long states = 0;
+  // The number of processes, of integer variables, and the dimension
+  // of the DBMs (the number of clocks plus one).
+  unsigned processes = 0;
+  unsigned intvars = 0;
+  unsigned dbm_dim = 0;
+  // states x processes: the identifier of the location of each process.
+  std::vector<int32_t> locations;
+  // states x intvars: the values of the integer variables.
+  std::vector<int32_t> valuations;
+  // states x dbm_dim x dbm_dim: the zones, with TChecker's encoding of
+  // bounds (see tchecker/dbm/db.hh).
+  std::vector<int32_t> dbms;
+  // The successors of state i are edge_targets[edge_offsets[i]] to
+  // edge_targets[edge_offsets[i + 1] - 1] (compressed sparse rows).
+  std::vector<uint64_t> edge_offsets;
+  std::vector<uint32_t> edge_targets;
+  // The observed atomic propositions.  Bit j % 8 of byte j / 8 of row
+  // i of labels (states x label_bytes) is set if proposition j holds
+  // in state i.
+  std::vector<std::string> ap_names;
+  unsigned label_bytes = 0;
+  std::vector<uint8_t> labels;
+};
+
+// Explore all the states of K, built by tc_model::kripke().  If B is
+// given, it replaces the budget of K for the duration of the
+// exploration.  The limits count from the start of the exploration,
+// and tc_budget_exceeded is thrown if one is hit.
+TCLTL_API tc_state_space explore_state_space(const spot::const_twa_ptr& k,
+                                             tc_budget* b = nullptr);
+
+// Report the phases of tc_model::load() and tc_model::kripke() to T.
+// T is not owned by the library, and must outlive its use.  Passing
+// nullptr (the default) disables tracing.
+TCLTL_API void set_tcltl_trace(tc_trace* t);
+
+// Translate FORMULA into an automaton with spot::translator's default
+// options (a small TGBA, with high optimizations).
+//
+// The automata are saved in HOA format in a cache directory, keyed by
+// the formula, the translation options, and the version of Spot, so
+// that later calls (by any process) can skip the translation.  The
+// directory is $TCLTL_CACHE_DIR if set (an empty value disables the
+// cache), or $XDG_CACHE_HOME/tcltl, or ~/.cache/tcltl.  A cache that
+// cannot be read or written only makes this function translate.
+TCLTL_API spot::twa_graph_ptr
+translate_cached(spot::formula formula, spot::bdd_dict_ptr dict);
@@ -1,5 +1,6 @@
 import spot
 import spot.tchecker as tc
+import os
 import tempfile
 
 # this was generated with "examples/critical-region.sh 1" in tchecker
@@ -59,3 +60,193 @@ try:
     satisfies(model, 'G(arbiter1.req | foo)')
 except RuntimeError as e:
     assert "foo" in str(e)
+
+# Exploration statistics and progress reports.
+reports = []
+f = spot.formula('G(arbiter1.req | arbiter1.ack)')
+k = model.kripke(spot.atomic_prop_collect(f),
+                 progress=lambda stats, elapsed: reports.append(elapsed),
+                 progress_period=0)
+assert not k.intersects(spot.translate(spot.formula_Not(f)))
+stats = tc.kripke_stats(k)
+assert stats.states_generated > 0
+assert stats.states_visited > 0
+assert stats.state_conditions > 0
+# No iterator is in use once the search is over, even if one is kept
+# for recycling.
+assert stats.depth == 0
+assert all(e >= 0 for e in reports)
+
+# Translated formulas are cached on disk.
+nf = spot.formula_Not(f)
+n1 = tc.translate(nf)
+n2 = tc.translate(nf)
+assert spot.are_equivalent(n1, n2)
+assert any(name.endswith('.hoa')
+           for name in os.listdir(os.environ['TCLTL_CACHE_DIR']))
+assert not model.kripke(spot.atomic_prop_collect(f)).intersects(n2)
+
+# Checks may be given a budget, and give up when it is exhausted.
+aps = spot.atomic_prop_collect(spot.formula('arbiter1.req & arbiter1.ack'))
+r = tc.check(model.kripke(aps), 'G(arbiter1.req | arbiter1.ack)')
+assert r.verdict == tc.verdict_satisfied
+assert r.stats.states_visited > 1
+r = tc.check(model.kripke(aps), 'G(arbiter1.req -> F(arbiter1.ack))')
+assert r.verdict == tc.verdict_violated
+assert r.run is not None
+b = tc.budget()
+b.max_states = 1
+r = tc.check(model.kripke(aps), 'G(arbiter1.req | arbiter1.ack)', b)
+assert r.verdict == tc.verdict_unknown
+assert r.limit == tc.limit_states
+assert r.reason == 'state limit reached'
+assert r.stats.states_visited == 1
+# A check that hits a limit leaves the Kripke structure usable.
+k = model.kripke(aps)
+r = tc.check(k, 'G(arbiter1.req | arbiter1.ack)', b)
+assert r.verdict == tc.verdict_unknown
+r = tc.check(k, 'G(arbiter1.req | arbiter1.ack)')
+assert r.verdict == tc.verdict_satisfied
+assert r.stats.depth == 0
+r2 = tc.check(model.kripke(aps), 'G(arbiter1.req | arbiter1.ack)')
+assert r.stats.states_visited == r2.stats.states_visited + 1
+assert r.stats.transitions_visited >= r2.stats.transitions_visited
+# The limits apply to each check separately.
+k = model.kripke(aps)
+r = tc.check(k, 'G(arbiter1.req | arbiter1.ack)')
+b = tc.budget()
+b.max_states = r.stats.states_visited
+for i in range(2):
+    r = tc.check(k, 'G(arbiter1.req | arbiter1.ack)', b)
+    assert r.verdict == tc.verdict_satisfied
+b = tc.budget()
+b.cancel()
+k = model.kripke(aps, budget=b)
+r = tc.check(k, 'G(arbiter1.req | arbiter1.ack)')
+assert r.verdict == tc.verdict_unknown
+assert r.limit == tc.limit_cancelled
+# Spot's algorithms are not interrupted by an exception: the Kripke
+# structure just stops giving successors, and has to be asked whether
+# their result is complete.
+assert not k.intersects(spot.translate('!G(arbiter1.req -> F arbiter1.ack)'))
+try:
+    tc.check_kripke_budget(k)
+except RuntimeError as e:
+    assert 'exploration cancelled' in str(e)
+else:
+    assert False
+b.reset()
+assert tc.check(k, 'G(arbiter1.req | arbiter1.ack)').verdict \
+    == tc.verdict_satisfied
+
+# Models may be loaded by several threads at the same time, since the
+# GIL is released while loading.
+import concurrent.futures
+with concurrent.futures.ThreadPoolExecutor(4) as ex:
+    models = list(ex.map(lambda fast: tc.load(model_txt, fast),
+                         [False, True, False, True]))
+for m in models:
+    assert tc.check(m.kripke(aps), 'G(arbiter1.req | arbiter1.ack)').verdict \
+        == tc.verdict_satisfied
+
+# The state space can be exported to NumPy.
+try:
+    import numpy as np
+except ImportError:
+    np = None
+if np is not None:
+    k = model.kripke(aps)
+    s = tc.state_space(k)
+    n = len(s.locations)
+    assert n == tc.kripke_stats(k).states_visited
+    assert s.locations.shape == (n, 3)
+    assert s.valuations.shape == (n, 1)
+    assert s.dbms.shape[0] == n and s.dbms.shape[1] == s.dbms.shape[2]
+    assert s.edge_offsets.shape == (n + 1,)
+    assert s.edge_offsets[-1] == len(s.edge_targets)
+    assert s.edge_targets.max() < n
+    assert sorted(s.ap_names) == ['arbiter1.ack', 'arbiter1.req']
+    bits = np.unpackbits(s.labels, axis=1, bitorder='little')
+    req = bits[:, s.ap_names.index('arbiter1.req')]
+    ack = bits[:, s.ap_names.index('arbiter1.ack')]
+    assert ((req ^ ack) == 1).all()
+    # The arrays remain valid on their own.
+    locations = s.locations
+    del k, s, bits, req, ack
+    assert locations.shape == (n, 3) and locations.min() >= 0
+
+# Checks can run in the background, and be awaited from asyncio.
+import asyncio
+h = tc.check_async(model.kripke(aps), 'G(arbiter1.req -> F(arbiter1.ack))')
+r = h.result()
+assert r.verdict == tc.verdict_violated
+assert 'Cycle:' in h.counterexample()
+assert h.done()
+h.cancel()
+assert h.progress()['states'] >= 0
+
+async def check_all(formulas):
+    return await asyncio.gather(*[tc.check_async(model.kripke(aps), f)
+                                  for f in formulas])
+rs = asyncio.run(check_all(['G(arbiter1.req | arbiter1.ack)',
+                            'G(arbiter1.req -> F(arbiter1.ack))']))
+assert [r.verdict for r in rs] == [tc.verdict_satisfied,
+                                   tc.verdict_violated]
+b = tc.budget()
+b.max_states = 1
+r = tc.check_async(model.kripke(aps), 'G(arbiter1.req | arbiter1.ack)',
+                   b).result()
+assert r.verdict == tc.verdict_unknown and r.limit == tc.limit_states
+
+# Several formulas may be checked against one Kripke structure.
+rows = model.check_many(['G(arbiter1.req | arbiter1.ack)',
+                         'G(arbiter1.req -> F(arbiter1.ack))',
+                         'G(arbiter1.req -> !arbiter1.ack)'], jobs=2)
+assert [r['verdict'] for r in rows] == [tc.verdict_satisfied,
+                                        tc.verdict_violated,
+                                        tc.verdict_satisfied]
+assert rows[0]['counterexample'] == ''
+assert 'Cycle:' in rows[1]['counterexample']
+assert all(r['stats'].states_generated > 0 for r in rows)
+assert rows[2]['formula'] == spot.formula('G(arbiter1.req -> !arbiter1.ack)')
+# Each check gets the whole budget.
+b = tc.budget()
+b.max_states = max(r['stats'].states_visited for r in rows)
+b.set_timeout(60)
+rows2 = model.check_many([str(r['formula']) for r in rows], jobs=1,
+                         budget=b)
+assert [r['verdict'] for r in rows2] == [r['verdict'] for r in rows]
+try:
+    model.check_many(['G(arbiter1.req | foo)'])
+except RuntimeError as e:
+    assert "foo" in str(e)
+
+# Models can be pickled, as their text.
+import pickle
+m = tc.load(model_txt)
+m2 = pickle.loads(pickle.dumps(m))
+assert m2.source() == m.source() == model_txt
+assert [r['verdict'] for r in m2.check_many(['G(arbiter1.req | arbiter1.ack)'],
+                                            jobs=1)] == [tc.verdict_satisfied]
+# The file of the other model has been removed.
+try:
+    pickle.dumps(model)
+except RuntimeError as e:
+    assert "cannot read" in str(e)
+else:
+    assert False
+# A file rewritten with the same size, within the same second, is
+# detected as modified.
+with tempfile.NamedTemporaryFile(dir='.', suffix='.tc', mode='w') as t:
+    t.write(model_txt)
+    t.flush()
+    m = tc.load(t.name)
+    t.seek(0)
+    t.write(model_txt.replace('x1<=20', 'x1<=21', 1))
+    t.flush()
+    try:
+        m.source()
+    except RuntimeError as e:
+        assert "was modified" in str(e)
+    else:
+        assert False